@@ -2,8 +2,14 @@
 // by Adam Ullmann
 
 #include <rlvk/rlvk.hpp>
+#include <rlvk/rlprof.hpp>
+#include "census.hpp"
 #include <math.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
 #include <vector>
 
 const int screenWidth = 1600;
@@ -12,8 +18,32 @@ const float cellSize = 1.0f;
 const int gridWidth = 50;
 const int gridHeight = 50;
 const int gridDepth = 50;
+const int censusInterval = 100;     // generations between structure counts
 bool grid[gridWidth][gridHeight][gridDepth] = { 0 };
 bool nextGrid[gridWidth][gridHeight][gridDepth] = { 0 };
+unsigned int gridBits[(gridWidth * gridHeight * gridDepth + 31) / 32] = { 0 };   // grid packed one bit per cell, for DrawVoxelGrid
+
+// cell coloring, each mode maps a per-cell shade (0-255) through its own palette
+enum ColorMode {
+    COLOR_DISTANCE = 0,     // distance from the grid center
+    COLOR_AGE,              // generations a cell has been alive
+    COLOR_NEIGHBORS,        // live neighbors at the last update
+    COLOR_MODE_COUNT
+};
+const char* colorModeNames[COLOR_MODE_COUNT] = { "distance", "age", "neighbors" };
+Color palettes[COLOR_MODE_COUNT][256];
+unsigned char distanceShades[gridWidth][gridHeight][gridDepth] = { 0 };     // constant, filled once from CalculateGradient
+unsigned char ageShades[gridWidth][gridHeight][gridDepth] = { 0 };
+unsigned char neighborShades[gridWidth][gridHeight][gridDepth] = { 0 };
+
+// live cells per (x, z) column and the shadow alpha they cast, kept current by SyncCell
+int columnPopulation[gridWidth][gridDepth] = { 0 };
+unsigned char shadowMap[gridWidth][gridDepth] = { 0 };
+
+// orbit camera state, updated once per frame from the input the frame saw
+float cameraAngleX = 0.0f;
+float cameraAngleY = 0.0f;
+float cameraZoom = 150.0f;
 
 /*
 void DrawShadow(const Camera3D& camera, const Vector3& lightPosition) {
@@ -49,42 +79,157 @@ float CalculateGradient(int x, int y, int z) {
     return distance / maxDistance;
 }
 
-bool IsCubeInFrustum(const Vector3& position, float size, const Matrix& projview) {
-    Vector4 planes[6];
-
-    // Extract frustum planes from the combined projection and view matrix
-    planes[0] = { projview.m3 + projview.m0, projview.m7 + projview.m4, projview.m11 + projview.m8, projview.m15 + projview.m12 }; // Left
-    planes[1] = { projview.m3 - projview.m0, projview.m7 - projview.m4, projview.m11 - projview.m8, projview.m15 - projview.m12 }; // Right
-    planes[2] = { projview.m3 + projview.m1, projview.m7 + projview.m5, projview.m11 + projview.m9, projview.m15 + projview.m13 }; // Bottom
-    planes[3] = { projview.m3 - projview.m1, projview.m7 - projview.m5, projview.m11 - projview.m9, projview.m15 - projview.m13 }; // Top
-    planes[4] = { projview.m3 + projview.m2, projview.m7 + projview.m6, projview.m11 + projview.m10, projview.m15 + projview.m14 }; // Near
-    planes[5] = { projview.m3 - projview.m2, projview.m7 - projview.m6, projview.m11 - projview.m10, projview.m15 - projview.m14 }; // Far
-
-    // Check against the frustum planes
-    for (int i = 0; i < 6; i++) {
-        Vector3 normal = { planes[i].x, planes[i].y, planes[i].z };
-        float distance = planes[i].w;
-        float distanceToCenter = Vector3DotProduct(normal, position) + distance;
-        if (distanceToCenter < -size * 250.0f )
-            return false;
+// linear ramp between two colors
+void BuildPalette(Color* palette, Color from, Color to) {
+    for (int i = 0; i < 256; i++)
+        palette[i] = Color(glm::mix(glm::vec4(from), glm::vec4(to), i / 255.0f));
+}
+
+int min(int a, int b) {
+    return (a < b) ? a : b;
+}
+
+// keeps the packed bit, the retained GPU instance and the column shadow of a cell in sync with its state in grid
+// NOTE: call once per birth or death (and once per initially live cell), the column counts rely on it
+void SyncCell(int x, int y, int z) {
+    int id = (x * gridHeight + y) * gridDepth + z;
+    if (grid[x][y][z])
+        gridBits[id / 32] |= 1u << (id % 32);
+    else
+        gridBits[id / 32] &= ~(1u << (id % 32));
+
+    if (grid[x][y][z])
+        UpdateCellInstance(id, x, y, z, distanceShades[x][y][z]);
+    else
+        RemoveCellInstance(id);
+
+    columnPopulation[x][z] += grid[x][y][z] ? 1 : -1;
+    shadowMap[x][z] = (unsigned char)min(columnPopulation[x][z] * 15, 255);
+}
+
+// places the camera on its orbit around the center of the main cube
+void OrbitCamera(Camera3D& camera, float angleX, float angleY, float zoom) {
+    if (angleY > 89.9f)           // weird bug fix. limits camera y axis
+        angleY = 89.9f;
+    else if (angleY < -89.9f)
+        angleY = -89.9f;
+
+    // updates camera position and target based on camera angles
+    camera.position.x = cosf(DEG2RAD * angleX) * cosf(DEG2RAD * angleY) * zoom;
+    camera.position.y = sinf(DEG2RAD * angleY) * 100.0f;
+    camera.position.z = sinf(DEG2RAD * angleX) * cosf(DEG2RAD * angleY) * zoom;
+    Vector3 target = { 25.0f, 25.0f, 25.0f };
+    camera.target = target;     // camera looking at a point in the center of the main cube
+}
+
+// called right before the frame is submitted, applies the mouse movement since the frame's input without committing it
+Camera3D LatchCamera(Camera3D camera) {
+    Vector2 mouseDelta = GetMouseDelta();
+    float zoom = cameraZoom - GetMouseWheelMove() * 5.0f;
+    OrbitCamera(camera, cameraAngleX + mouseDelta.x * 0.1f, cameraAngleY + mouseDelta.y * 0.1f, zoom < 1.0f ? 1.0f : zoom);
+    return camera;
+}
+
+// first screenshotNNN.png that does not exist yet, so earlier screenshots are kept
+std::string NextScreenshotName() {
+    for (int i = 0; i < 1000; i++) {
+        std::string name = TextFormat("screenshot%03d.png", i);
+        if (!std::ifstream(name))
+            return name;
     }
+    return "screenshot999.png";
+}
 
-    return true;
+void PrintCaptureStats() {
+    CaptureStats capture = GetCaptureStats();
+    std::cout << "capture: " << capture.captured << " captured, " << capture.written << " written, " << capture.failed << " failed, " << capture.pending << " pending, "
+        << capture.stalls << " stalls, encode ms " << capture.encodeMs << std::endl;
 }
 
+// draws the retained instances with GPU culling on and then off from a camera inside the grid, where most cells are
+// behind or beside it, and returns whether the two offscreen frames match pixel for pixel (headless only)
+bool CompareCulling() {
+    for (int x = 0; x < gridWidth; x++)
+        for (int y = 0; y < gridHeight; y++)
+            for (int z = 0; z < gridDepth; z++)
+                if (!grid[x][y][z] && (x + y + z) % 7 == 0) {
+                    grid[x][y][z] = true;
+                    SyncCell(x, y, z);
+                }
 
+    Camera3D camera = { 0 };
+    camera.position = Vector3{ 10.0f, 25.0f, 10.0f };
+    camera.target = Vector3{ 40.0f, 25.0f, 40.0f };
+    camera.up = Vector3{ 0.0f, 1.0f, 0.0f };
+    camera.fovy = 60.0f;
+    camera.projection = CAMERA_PERSPECTIVE;
+    SetCameraLatch(NULL);
+
+    std::vector<unsigned char> frames[2];
+    int width = 0;
+    int height = 0;
+    GetFramePixels(&width, &height);    // frames are only copied to host memory once asked for
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 0)
+            rlEnableGpuCulling();
+        else
+            rlDisableGpuCulling();
+
+        // the pixels trail by the frames in flight, so enough frames are drawn for one of this pass to come back
+        for (int frame = 0; frame < 3; frame++) {
+            BeginDrawing();
+            ClearBackground(RAYWHITE);
+            BeginMode3D(camera);
+            DrawCellInstances();
+            DrawCellInstanceWires(BLACK);
+            EndMode3D();
+            EndDrawing();
+        }
+        const unsigned char* pixels = GetFramePixels(&width, &height);
+        if (pixels == NULL) {
+            std::cout << "culling comparison: no headless frame came back" << std::endl;
+            return false;
+        }
+        frames[pass].assign(pixels, pixels + width * height * 4);
+    }
 
-int min(int a, int b) {
-    return (a < b) ? a : b;
+    int differing = 0;
+    for (int i = 0; i < width * height; i++)
+        if (memcmp(&frames[0][i * 4], &frames[1][i * 4], 4) != 0)
+            differing++;
+    std::cout << "culling comparison: " << GetCellInstanceCount() << " cells, " << differing << " of " << width * height << " pixels differ between culled and unculled" << std::endl;
+    return differing == 0;
 }
 
-int main() {
+int main(int argc, char** argv) {
+
+    // --headless <frames> renders that many frames offscreen as fast as possible, then exits (benchmarks, display-less machines)
+    // --record captures every frame from the first one
+    // --compare-culling renders one headless frame with GPU culling and one without, and exits with 1 when they differ
+    int headlessFrames = 0;
+    bool recording = false;
+    bool compareCulling = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc)
+            headlessFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--record") == 0)
+            recording = true;
+        else if (strcmp(argv[i], "--compare-culling") == 0)
+            compareCulling = true;
+    }
 
-    SetConfigFlags(FLAG_MSAA_4X_HINT);
+    SetConfigFlags(FLAG_MSAA_4X_HINT | (headlessFrames > 0 || compareCulling ? FLAG_WINDOW_HEADLESS : 0));
     InitWindow(screenWidth, screenHeight, "Cellular Automata 3D");   // initialization
     unsigned int targetFPS = 60;
-    SetTargetFPS(targetFPS);
+    if (headlessFrames == 0 && !compareCulling)
+        SetTargetFPS(targetFPS);
+    if (recording)
+        BeginFrameCapture("frame%05d.png");
     rlEnableBackfaceCulling();
+    rlEnableGpuCulling();
+    rlEnableOcclusionCulling();
+    rlEnableLod();
+    SetCameraLatch(LatchCamera);
 
     Camera3D camera = { 0 };
     Vector3 position = { 85.0f, 85.0f, 85.0f };
@@ -106,29 +251,116 @@ int main() {
     grid[gridWidth / 2 + 1][gridHeight / 2][gridDepth / 2 + 1] = true;
     grid[gridWidth / 2 + 1][gridHeight / 2 + 1][gridDepth / 2 + 1] = true;
 
-
-
-    float cameraAngleX = 0.0f;
-    float cameraAngleY = 0.0f;
-    float cameraZoom = 150.0f;
+    BuildPalette(palettes[COLOR_DISTANCE], Color{ 0, 0, 0, 255 }, Color{ 30, 100, 255, 255 });
+    BuildPalette(palettes[COLOR_AGE], Color{ 255, 220, 80, 255 }, Color{ 120, 20, 60, 255 });
+    BuildPalette(palettes[COLOR_NEIGHBORS], Color{ 60, 200, 90, 255 }, Color{ 150, 40, 200, 255 });
+    for (int x = 0; x < gridWidth; x++)
+        for (int y = 0; y < gridHeight; y++)
+            for (int z = 0; z < gridDepth; z++)
+                distanceShades[x][y][z] = (unsigned char)min(int(CalculateGradient(x, y, z) * 255.0f), 255);
+    SetCellGrid(Vector3{ 0.0f, 0.0f, 0.0f }, cellSize, palettes[COLOR_DISTANCE]);
+
+    for (int x = 0; x < gridWidth; x++)
+        for (int y = 0; y < gridHeight; y++)
+            for (int z = 0; z < gridDepth; z++)
+                if (grid[x][y][z])
+                    SyncCell(x, y, z);
+
+    if (compareCulling) {
+        bool match = CompareCulling();
+        CloseWindow();
+        return match ? 0 : 1;
+    }
 
     bool drawCubes = true;
     bool drawWires = false;
+    bool useVoxelGrid = true;           // expand the packed grid on the GPU instead of drawing retained instances
+    bool gpuCulling = true;             // frustum cull retained instances in a compute pass
+    bool occlusionCulling = true;       // skip voxel bricks hidden behind nearer ones
+    bool lod = true;                    // draw distant voxel bricks coarser and skip sub-pixel wires
+    bool rayMarching = false;           // march the voxel grid per pixel instead of rasterizing its faces
+    int colorMode = COLOR_DISTANCE;     // voxel grid coloring, retained instances always use distance
+    bool vsync = false;                 // wait for vblank on present, the FPS limit still applies on top
+    bool lateLatch = true;              // re-place the camera with input polled right before submission
     bool pause = false;
+    int generation = 0;
+    int cellsDrawn = 0;
+    bool startupReported = false;       // startup timings are printed once, after the first frame
+    int rateGenerations = 0;            // generations since rateStart, for the gen/s readout
+    double rateStart = GetTime();
+    float generationsPerSecond = 0.0f;
+    int framesRendered = 0;
+    double loopStart = GetTime();
 
     
     // game loop
-    while (!WindowShouldClose()) {
+    while (headlessFrames > 0 ? framesRendered < headlessFrames : !WindowShouldClose()) {
         // INPUT
+        uint64_t inputBegin = GetProfileTime();
         if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
             drawCubes = !drawCubes; 
         }
         if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
             drawWires = !drawWires;
         }
+        if (IsKeyPressed(KEY_V)) {
+            useVoxelGrid = !useVoxelGrid;
+        }
+        if (IsKeyPressed(KEY_C)) {
+            gpuCulling = !gpuCulling;
+            if (gpuCulling)
+                rlEnableGpuCulling();
+            else
+                rlDisableGpuCulling();
+        }
+        if (IsKeyPressed(KEY_O)) {
+            occlusionCulling = !occlusionCulling;
+            if (occlusionCulling)
+                rlEnableOcclusionCulling();
+            else
+                rlDisableOcclusionCulling();
+        }
+        if (IsKeyPressed(KEY_K)) {
+            lod = !lod;
+            if (lod)
+                rlEnableLod();
+            else
+                rlDisableLod();
+        }
+        if (IsKeyPressed(KEY_G)) {
+            rayMarching = !rayMarching;
+            if (rayMarching)
+                rlEnableRayMarching();
+            else
+                rlDisableRayMarching();
+        }
+        if (IsKeyPressed(KEY_M)) {
+            colorMode = (colorMode + 1) % COLOR_MODE_COUNT;
+        }
+        if (IsKeyPressed(KEY_Y)) {
+            vsync = !vsync;
+            if (vsync)
+                SetWindowState(FLAG_VSYNC_HINT);
+            else
+                ClearWindowState(FLAG_VSYNC_HINT);
+        }
+        if (IsKeyPressed(KEY_L)) {
+            lateLatch = !lateLatch;
+            SetCameraLatch(lateLatch ? LatchCamera : NULL);
+        }
         if (IsKeyPressed(KEY_SPACE)) {
             pause = !pause; 
         }
+        if (IsKeyPressed(KEY_F12)) {
+            TakeScreenshot(NextScreenshotName().c_str());
+        }
+        if (IsKeyPressed(KEY_R)) {
+            recording = !recording;
+            if (recording)
+                BeginFrameCapture("frame%05d.png");
+            else
+                EndFrameCapture();
+        }
         if (IsKeyDown(KEY_UP) && targetFPS < 240) {
             targetFPS += 1;
             SetTargetFPS(targetFPS);
@@ -137,6 +369,18 @@ int main() {
             targetFPS -= 1;
             SetTargetFPS(targetFPS);
         }
+        if (IsKeyPressed(KEY_F2)) {
+            GpuTimings gpu = GetGpuTimings();
+            std::cout << GetProfileSummary(2.0);
+            std::cout << "gpu ms: upload " << gpu.upload << ", occlusion " << gpu.occlusion << ", wires " << gpu.wires << ", solids " << gpu.solids << ", hud " << gpu.hud << ", total " << gpu.total << std::endl;
+            FramePacing pacing = GetFramePacing();
+            std::cout << "input latency ms: " << GetInputLatency() << (lateLatch ? " (late latched)" : "") << std::endl;
+            std::cout << "pacing ms: sleep " << pacing.sleep << ", spin " << pacing.spin << ", jitter " << pacing.jitter << ", max error " << pacing.maxError << ", present mode " << pacing.presentMode << std::endl;
+            PrintCaptureStats();
+        }
+        if (IsKeyPressed(KEY_F3)) {
+            ExportProfileTrace("trace.json");
+        }
 
         //UpdateCamera(&camera);
 
@@ -150,13 +394,6 @@ int main() {
         else if (cameraAngleY < -89.9f)
             cameraAngleY = -89.9f;
 
-        // updates camera position and target based on camera angles
-        camera.position.x = cosf(DEG2RAD * cameraAngleX) * cosf(DEG2RAD * cameraAngleY) * cameraZoom;
-        camera.position.y = sinf(DEG2RAD * cameraAngleY) * 100.0f;
-        camera.position.z = sinf(DEG2RAD * cameraAngleX) * cosf(DEG2RAD * cameraAngleY) * cameraZoom;
-        Vector3 target = { 25.0f, 25.0f, 25.0f };
-        camera.target = target;     // camera looking at a point in the center of the main cube
-
         // updates camera up vector based on camera angles
         //camera.up.x = cosf(DEG2RAD * cameraAngleX) * cosf(DEG2RAD * (cameraAngleY + 90.0f));
         //camera.up.y = sinf(DEG2RAD * (cameraAngleY + 90.0f));
@@ -167,6 +404,9 @@ int main() {
         if (cameraZoom < 1.0f)
             cameraZoom = 1.0f;
 
+        OrbitCamera(camera, cameraAngleX, cameraAngleY, cameraZoom);
+        ProfileRecord("input", inputBegin, GetProfileTime());
+
         //UpdateCamera(&camera);
 
 
@@ -176,6 +416,7 @@ int main() {
 
 
             // update
+            uint64_t updateBegin = GetProfileTime();
             for (int z = 0; z < gridDepth; z++) {
                 for (int y = 0; y < gridHeight; y++) {
                     for (int x = 0; x < gridWidth; x++) {
@@ -198,6 +439,8 @@ int main() {
                             }
                         }
 
+                        neighborShades[x][y][z] = (unsigned char)(liveNeighbors * 255 / 26);
+
                         // rules (hardcoded for now)
                         if (grid[x][y][z]) {
                             if (liveNeighbors == 6 || liveNeighbors == 11) {
@@ -218,15 +461,43 @@ int main() {
                     }
                 }
             }
-            // next generation
+            ProfileRecord("update", updateBegin, GetProfileTime());
+            // next generation, only births and deaths touch the cell instances
+            uint64_t gridCopyBegin = GetProfileTime();
             for (int z = 0; z < gridDepth; z++) {           
                 for (int y = 0; y < gridHeight; y++) {
                     for (int x = 0; x < gridWidth; x++) {
-                        grid[x][y][z] = nextGrid[x][y][z];
+                        if (grid[x][y][z] != nextGrid[x][y][z]) {
+                            grid[x][y][z] = nextGrid[x][y][z];
+                            ageShades[x][y][z] = 0;
+                            SyncCell(x, y, z);
+                        }
+                        else if (grid[x][y][z]) {
+                            ageShades[x][y][z] = (unsigned char)min(ageShades[x][y][z] + 4, 255);
+                        }
                     }
                 }
             }
+            ProfileRecord("grid copy", gridCopyBegin, GetProfileTime());
+            generation++;
+            rateGenerations++;
+
+            // census of the distinct structures (gliders, blobs, debris)
+            if (generation % censusInterval == 0) {
+                PROFILE_ZONE("census");
+                std::vector<Structure> structures = LabelStructures(&grid[0][0][0], gridWidth, gridHeight, gridDepth, CONNECTIVITY_26);
+                int largest = 0;
+                for (const Structure& structure : structures)
+                    largest = structure.cells > largest ? structure.cells : largest;
+                std::cout << "generation " << generation << ": " << structures.size() << " structures, largest " << largest << " cells" << std::endl;
+            }
         }
+        if (GetTime() - rateStart >= 1.0) {
+            generationsPerSecond = float(rateGenerations / (GetTime() - rateStart));
+            rateGenerations = 0;
+            rateStart = GetTime();
+        }
+
         // start drawing section
         
             BeginDrawing();
@@ -242,42 +513,25 @@ int main() {
             //Vector3 cubePosition = { 0.0f, 0.0f, 0.0f };          // red dot on origin for debugging
             //DrawCube(cubePosition, 2.0f, 2.0f, 2.0f, RED);
 
-            Matrix projview = GetCameraMatrix(camera);
             //OctreeNode* octreeRoot = BuildOctree(0, 0, 0, gridWidth, gridHeight, gridDepth);
                 // drawing of cells
-            int shadowIntensities[gridWidth][gridDepth] = {};
-                for (int z = 0; z < gridDepth; z++) {
-                    for (int y = 0; y < gridHeight; y++) {
-                        for (int x = 0; x < gridWidth; x++) {
-                            if (grid[x][y][z]) {
-                                Vector3 cubePosition = { x * cellSize, y * cellSize, z * cellSize };
- 
-                                if (IsCubeInFrustum(cubePosition, cellSize, projview)) {
-                                        float gradient = CalculateGradient(x, y, z);
-                                        Color cellColor = Color{ unsigned char(30 * gradient), unsigned char(100 * gradient), unsigned char(255 * gradient), 255 };
-                                        if (drawCubes) {
-                                            DrawCube(cubePosition, cellSize, cellSize, cellSize, cellColor);
-                                        }
-                                        if (drawWires) {
-                                            DrawCubeWires(cubePosition, cellSize, cellSize, cellSize, BLACK);
-                                        }
-                                        shadowIntensities[x][z] += 15;
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                
-            
-                for (int z = 0; z < gridDepth; z++) {
-                    for (int x = 0; x < gridWidth; x++) {
-                        if (shadowIntensities[x][z] > 0) {
-                            Vector3 shadowPosition = { x * cellSize, 0.0f, z * cellSize };
-                            DrawCube(shadowPosition, cellSize, 0.0f, cellSize, Color{ 0, 0, 0, (unsigned char)min(shadowIntensities[x][z], 255)});
-                        }
-                    }
-                }
+            cellsDrawn = drawCubes ? GetCellInstanceCount() : 0;
+            if (drawCubes && useVoxelGrid && colorMode == COLOR_DISTANCE) {
+                DrawVoxelGrid(gridBits, gridWidth, gridHeight, gridDepth, Vector3{ 0.0f, 0.0f, 0.0f }, cellSize, Color{ 0, 0, 0, 255 }, Color{ 30, 100, 255, 255 });
+            }
+            else if (drawCubes && useVoxelGrid) {
+                DrawVoxelGridShaded(gridBits, colorMode == COLOR_AGE ? &ageShades[0][0][0] : &neighborShades[0][0][0], gridWidth, gridHeight, gridDepth, Vector3{ 0.0f, 0.0f, 0.0f }, cellSize, palettes[colorMode]);
+            }
+            else if (drawCubes) {
+                DrawCellInstances();
+            }
+
+            // wires come from the retained instances too, culled on the GPU along with the solids
+            if (drawWires)
+                DrawCellInstanceWires(BLACK);
+
+            // the column map is maintained by the simulation, so the shadow costs the same at any population
+            DrawDensityMap(&shadowMap[0][0], gridWidth, gridDepth, Vector3{ 0.0f, 0.0f, 0.0f }, cellSize, BLACK);
                 
       
                 
@@ -289,12 +543,33 @@ int main() {
 
         EndMode3D();
         DrawFPS(2, 2);
+        DrawText(TextFormat("%d cells drawn", cellsDrawn), 2, 38, 16, DARKGRAY);
+        DrawText(TextFormat("%.1f gen/s", generationsPerSecond), 2, 56, 16, DARKGRAY);
+        DrawText(TextFormat("color: %s", colorModeNames[colorMode]), 2, 74, 16, DARKGRAY);
+        if (headlessFrames > 0 && framesRendered + 1 == headlessFrames)
+            TakeScreenshot("headless.png");
         EndDrawing();
+        framesRendered++;
         //end of draw
+
+        if (!startupReported) {
+            StartupTimings startup = GetStartupTimings();
+            std::cout << "startup ms: window " << startup.window << ", device " << startup.device << ", swapchain " << startup.swapchain << ", InitWindow " << startup.init
+                << ", pipelines " << startup.pipelines << " (cache " << (startup.pipelineCacheHit ? "hit" : "miss") << ", first frame waited " << startup.pipelineWait << ")"
+                << ", first frame " << startup.firstFrame << std::endl;
+            startupReported = true;
+        }
+    }
+
+    if (headlessFrames > 0) {
+        double seconds = GetTime() - loopStart;
+        std::cout << "headless: " << framesRendered << " frames in " << seconds << " s (" << framesRendered / seconds << " fps), " << generation << " generations" << std::endl;
     }
 
     // De-Initialization
-    CloseWindow();
+    CloseWindow();     // also writes the captures still in flight
+    if (GetCaptureStats().captured > 0)
+        PrintCaptureStats();
 
     return 0;
 }
@@ -0,0 +1,240 @@
+// census.cpp
+// connected structure labeling of the live cell grid
+
+#include "census.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+    // a maximal span of live cells along z within one (x, y) row
+    struct Run {
+        int z0;
+        int z1;     // inclusive
+    };
+
+    // running totals for one structure
+    struct Accum {
+        int64_t cells = 0;
+        glm::ivec3 min = glm::ivec3(INT_MAX);
+        glm::ivec3 max = glm::ivec3(INT_MIN);
+        double sumX = 0.0;
+        double sumY = 0.0;
+        double sumZ = 0.0;
+
+        void Add(int x, int y, const Run& run) {
+            int length = run.z1 - run.z0 + 1;
+            cells += length;
+            min = glm::min(min, glm::ivec3(x, y, run.z0));
+            max = glm::max(max, glm::ivec3(x, y, run.z1));
+            sumX += double(x) * length;
+            sumY += double(y) * length;
+            sumZ += (run.z0 + run.z1) * 0.5 * length;
+        }
+
+        void Merge(const Accum& other) {
+            cells += other.cells;
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+            sumX += other.sumX;
+            sumY += other.sumY;
+            sumZ += other.sumZ;
+        }
+    };
+
+    // lock-free union-find over run indices, a root is always the smallest index of its set
+    uint32_t FindRoot(std::atomic<uint32_t>* parent, uint32_t idx) {
+        while (true) {
+            uint32_t up = parent[idx].load(std::memory_order_relaxed);
+            if (up == idx)
+                return idx;
+            uint32_t grand = parent[up].load(std::memory_order_relaxed);
+            if (grand != up)        // path halving, any ancestor is a valid parent so a plain store is enough
+                parent[idx].store(grand, std::memory_order_relaxed);
+            idx = grand;
+        }
+    }
+
+    void Unite(std::atomic<uint32_t>* parent, uint32_t a, uint32_t b) {
+        if (parent[a].load(std::memory_order_relaxed) == parent[b].load(std::memory_order_relaxed))
+            return;
+        while (true) {
+            a = FindRoot(parent, a);
+            b = FindRoot(parent, b);
+            if (a == b)
+                return;
+            if (a < b)
+                std::swap(a, b);
+            uint32_t expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed))
+                return;
+        }
+    }
+
+    // unites the runs of two neighboring rows, slack widens the z overlap test for diagonal contact
+    void ConnectRows(std::atomic<uint32_t>* parent, const Run* runs, uint32_t a, uint32_t aEnd, uint32_t b, uint32_t bEnd, int slack) {
+        while (a < aEnd && b < bEnd) {
+            if (runs[a].z0 <= runs[b].z1 + slack && runs[b].z0 <= runs[a].z1 + slack)
+                Unite(parent, a, b);
+            if (runs[a].z1 < runs[b].z1)
+                a++;
+            else
+                b++;
+        }
+    }
+
+    template<typename Fn>
+    void ParallelFor(int count, Fn fn) {
+        std::vector<std::thread> workers;
+        for (int t = 1; t < count; t++)
+            workers.emplace_back(fn, t);
+        fn(0);
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+}
+
+std::vector<Structure> LabelStructures(const bool* cells, int width, int height, int depth, Connectivity connectivity) {
+    // tiles are slabs of whole x planes, so every row belongs to exactly one tile
+    int tiles = std::max(1, std::min<int>(std::thread::hardware_concurrency(), width));
+    std::vector<int> tileStart(tiles + 1);
+    for (int t = 0; t <= tiles; t++)
+        tileStart[t] = width * t / tiles;
+
+    // slack for rows sharing a face, and for rows sharing only an edge (-1 means not connected)
+    int faceSlack = connectivity == CONNECTIVITY_6 ? 0 : 1;
+    int edgeSlack = connectivity == CONNECTIVITY_6 ? -1 : (connectivity == CONNECTIVITY_18 ? 0 : 1);
+
+    // extract runs per tile, rowStart holds tile-local offsets for now
+    std::vector<uint32_t> rowStart(size_t(width) * height + 1);
+    std::vector<std::vector<Run>> tileRuns(tiles);
+    ParallelFor(tiles, [&](int t) {
+        std::vector<Run>& runs = tileRuns[t];
+        for (int x = tileStart[t]; x < tileStart[t + 1]; x++) {
+            for (int y = 0; y < height; y++) {
+                size_t row = size_t(x) * height + y;
+                const bool* cell = cells + row * depth;
+                rowStart[row] = uint32_t(runs.size());
+                const bool* end = cell + depth;
+                const bool* first = static_cast<const bool*>(memchr(cell, true, depth));
+                while (first) {
+                    const bool* last = first + 1;
+                    while (last < end && *last)
+                        last++;
+                    runs.push_back(Run{ int(first - cell), int(last - cell) - 1 });
+                    first = static_cast<const bool*>(memchr(last, true, end - last));
+                }
+            }
+        }
+    });
+
+    std::vector<uint32_t> tileBase(tiles + 1, 0);
+    for (int t = 0; t < tiles; t++)
+        tileBase[t + 1] = tileBase[t] + uint32_t(tileRuns[t].size());
+    uint32_t runCount = tileBase[tiles];
+    rowStart.back() = runCount;
+
+    std::vector<Run> runs(runCount);
+    std::vector<std::atomic<uint32_t>> parent(runCount);
+
+    // rebase row offsets to global run indices and seed the union-find
+    ParallelFor(tiles, [&](int t) {
+        size_t rowBegin = size_t(tileStart[t]) * height;
+        size_t rowEnd = size_t(tileStart[t + 1]) * height;
+        for (size_t row = rowBegin; row < rowEnd; row++)
+            rowStart[row] += tileBase[t];
+        std::copy(tileRuns[t].begin(), tileRuns[t].end(), runs.begin() + tileBase[t]);
+        std::vector<Run>().swap(tileRuns[t]);
+        for (uint32_t i = tileBase[t]; i < tileBase[t + 1]; i++)
+            parent[i].store(i, std::memory_order_relaxed);
+    });
+
+    // each tile unites its own rows, the first plane of a tile also reaches back into the previous tile,
+    // those border unions race with the neighbor's local ones which the lock-free union-find tolerates
+    ParallelFor(tiles, [&](int t) {
+        for (int x = tileStart[t]; x < tileStart[t + 1]; x++) {
+            for (int y = 0; y < height; y++) {
+                size_t row = size_t(x) * height + y;
+                if (rowStart[row] == rowStart[row + 1])
+                    continue;
+                if (y > 0)
+                    ConnectRows(parent.data(), runs.data(), rowStart[row], rowStart[row + 1], rowStart[row - 1], rowStart[row], faceSlack);
+                if (x == 0)
+                    continue;
+                for (int dy = -1; dy <= 1; dy++) {
+                    int slack = dy == 0 ? faceSlack : edgeSlack;
+                    if (slack < 0 || y + dy < 0 || y + dy >= height)
+                        continue;
+                    size_t prev = row - height + dy;
+                    ConnectRows(parent.data(), runs.data(), rowStart[row], rowStart[row + 1], rowStart[prev], rowStart[prev + 1], slack);
+                }
+            }
+        }
+    });
+
+    // flatten every run onto its root and count the roots owned by each tile
+    std::vector<uint32_t> rootBase(tiles + 1, 0);
+    ParallelFor(tiles, [&](int t) {
+        for (uint32_t i = tileBase[t]; i < tileBase[t + 1]; i++) {
+            uint32_t root = FindRoot(parent.data(), i);
+            parent[i].store(root, std::memory_order_relaxed);
+            if (root == i)
+                rootBase[t + 1]++;
+        }
+    });
+    for (int t = 0; t < tiles; t++)
+        rootBase[t + 1] += rootBase[t];
+
+    std::vector<Accum> accums(rootBase[tiles]);
+    std::vector<uint32_t> id(runCount);
+    ParallelFor(tiles, [&](int t) {
+        uint32_t next = rootBase[t];
+        for (uint32_t i = tileBase[t]; i < tileBase[t + 1]; i++) {
+            if (parent[i].load(std::memory_order_relaxed) == i)
+                id[i] = next++;
+        }
+    });
+
+    // a tile accumulates the structures rooted inside it directly, runs of structures rooted in an
+    // earlier tile are gathered locally and folded in afterwards
+    std::vector<std::unordered_map<uint32_t, Accum>> foreign(tiles);
+    ParallelFor(tiles, [&](int t) {
+        uint32_t cachedId = UINT32_MAX;
+        Accum* cached = nullptr;
+        for (int x = tileStart[t]; x < tileStart[t + 1]; x++) {
+            for (int y = 0; y < height; y++) {
+                size_t row = size_t(x) * height + y;
+                for (uint32_t i = rowStart[row]; i < rowStart[row + 1]; i++) {
+                    uint32_t root = parent[i].load(std::memory_order_relaxed);
+                    uint32_t structure = id[root];
+                    if (structure != cachedId) {
+                        cachedId = structure;
+                        cached = root >= tileBase[t] ? &accums[structure] : &foreign[t][structure];
+                    }
+                    cached->Add(x, y, runs[i]);
+                }
+            }
+        }
+    });
+    for (int t = 0; t < tiles; t++) {
+        for (const auto& entry : foreign[t])
+            accums[entry.first].Merge(entry.second);
+    }
+
+    std::vector<Structure> structures(accums.size());
+    for (size_t i = 0; i < accums.size(); i++) {
+        const Accum& acc = accums[i];
+        structures[i].cells = int(acc.cells);
+        structures[i].min = acc.min;
+        structures[i].max = acc.max;
+        structures[i].centroid = Vector3(acc.sumX / acc.cells, acc.sumY / acc.cells, acc.sumZ / acc.cells);
+    }
+
+    return structures;
+}
@@ -0,0 +1,27 @@
+#ifndef CENSUS_H
+#define CENSUS_H
+
+#include <rlvk/rldefs.hpp>
+#include <vector>
+
+// Cell connectivity used when grouping live cells into structures
+typedef enum {
+    CONNECTIVITY_6 = 6,         // Cells sharing a face
+    CONNECTIVITY_18 = 18,       // Cells sharing a face or an edge
+    CONNECTIVITY_26 = 26        // Cells sharing a face, an edge or a corner
+} Connectivity;
+
+// Structure, a connected group of live cells
+typedef struct Structure {
+    int cells;                  // Number of live cells
+    glm::ivec3 min;             // Bounding box minimum corner (grid coordinates, inclusive)
+    glm::ivec3 max;             // Bounding box maximum corner (grid coordinates, inclusive)
+    Vector3 centroid;           // Mean position of the live cells (grid coordinates)
+} Structure;
+
+// Label the connected structures of a width x height x depth grid laid out like bool[width][height][depth].
+// The grid is treated as bounded: structures that wrap around an edge are reported as separate pieces.
+// Structures are returned in the order their first cell is met scanning x, then y, then z.
+std::vector<Structure> LabelStructures(const bool* cells, int width, int height, int depth, Connectivity connectivity);
+
+#endif
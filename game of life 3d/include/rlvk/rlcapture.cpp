@@ -0,0 +1,190 @@
+#include "rlcapture.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static constexpr size_t gStoredBlockSize = 65535;  // largest stored deflate block
+
+static struct EncoderGlobals {
+	std::mutex mutex;                   // guards everything below
+	std::condition_variable wake;       // workers wait for jobs
+	std::condition_variable idle;       // EncodeWait waits for the queue to drain
+	std::deque<std::function<void()>> jobs;
+	std::vector<std::thread> workers;
+	int running = 0;                    // jobs taken off the queue and not finished yet
+	bool quit = false;
+} gEnc;
+
+// RGB rows, each led by PNG filter type 0 (none), so PPM output just skips the filter bytes
+static std::vector<unsigned char> packRows(const unsigned char* pixels, int width, int height, bool bgra) {
+	std::vector<unsigned char> rows((1 + static_cast<size_t>(width) * 3) * height);
+	unsigned char* out = rows.data();
+	for(int y = 0; y < height; y++) {
+		*out++ = 0;
+		const unsigned char* in = pixels + static_cast<size_t>(y) * width * 4;
+		for(int x = 0; x < width; x++, in += 4) {
+			*out++ = in[bgra ? 2 : 0];
+			*out++ = in[1];
+			*out++ = in[bgra ? 0 : 2];
+		}
+	}
+	return rows;
+}
+
+static uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size) {
+	static const std::vector<uint32_t> table = []() {
+		std::vector<uint32_t> t(256);
+		for(uint32_t n = 0; n < 256; n++) {
+			uint32_t c = n;
+			for(int k = 0; k < 8; k++) {
+				c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			}
+			t[n] = c;
+		}
+		return t;
+	}();
+
+	crc = ~crc;
+	for(size_t i = 0; i < size; i++) {
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void putBE32(std::vector<unsigned char>& out, uint32_t value) {
+	out.push_back(static_cast<unsigned char>(value >> 24));
+	out.push_back(static_cast<unsigned char>(value >> 16));
+	out.push_back(static_cast<unsigned char>(value >> 8));
+	out.push_back(static_cast<unsigned char>(value));
+}
+
+static void writeChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+	std::vector<unsigned char> chunk;
+	chunk.reserve(data.size() + 12);
+	putBE32(chunk, static_cast<uint32_t>(data.size()));
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	putBE32(chunk, crc32(0, chunk.data() + 4, chunk.size() - 4));
+	file.write(reinterpret_cast<const char*>(chunk.data()), chunk.size());
+}
+
+bool WritePNG(const char* fileName, const unsigned char* pixels, int width, int height, bool bgra) {
+	std::vector<unsigned char> rows = packRows(pixels, width, height, bgra);
+
+	// zlib stream of stored blocks, deflating a frame would take longer than rendering it
+	std::vector<unsigned char> idat;
+	idat.reserve(rows.size() + rows.size() / gStoredBlockSize * 5 + 16);
+	idat.push_back(0x78);
+	idat.push_back(0x01);
+	uint32_t a = 1, b = 0;
+	for(size_t offset = 0; offset < rows.size(); offset += gStoredBlockSize) {
+		size_t size = std::min(gStoredBlockSize, rows.size() - offset);
+		bool last = offset + size == rows.size();
+		idat.push_back(last ? 1 : 0);
+		idat.push_back(static_cast<unsigned char>(size));
+		idat.push_back(static_cast<unsigned char>(size >> 8));
+		idat.push_back(static_cast<unsigned char>(~size));
+		idat.push_back(static_cast<unsigned char>(~size >> 8));
+		idat.insert(idat.end(), rows.begin() + offset, rows.begin() + offset + size);
+
+		for(size_t i = offset; i < offset + size; i++) {
+			a = (a + rows[i]) % 65521;
+			b = (b + a) % 65521;
+		}
+	}
+	putBE32(idat, (b << 16) | a);
+
+	std::vector<unsigned char> ihdr;
+	putBE32(ihdr, width);
+	putBE32(ihdr, height);
+	ihdr.push_back(8);  // bit depth
+	ihdr.push_back(2);  // truecolor
+	ihdr.push_back(0);  // deflate
+	ihdr.push_back(0);  // adaptive filtering
+	ihdr.push_back(0);  // no interlace
+
+	std::ofstream file(fileName, std::ios::binary);
+	if(!file) {
+		return false;
+	}
+	file.write("\x89PNG\r\n\x1a\n", 8);
+	writeChunk(file, "IHDR", ihdr);
+	writeChunk(file, "IDAT", idat);
+	writeChunk(file, "IEND", {});
+
+	return static_cast<bool>(file);
+}
+
+bool WritePPM(const char* fileName, const unsigned char* pixels, int width, int height, bool bgra) {
+	std::vector<unsigned char> rows = packRows(pixels, width, height, bgra);
+
+	std::ofstream file(fileName, std::ios::binary);
+	if(!file) {
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	size_t stride = 1 + static_cast<size_t>(width) * 3;
+	for(int y = 0; y < height; y++) {
+		file.write(reinterpret_cast<const char*>(rows.data() + y * stride + 1), stride - 1);
+	}
+
+	return static_cast<bool>(file);
+}
+
+static void worker() {
+	std::unique_lock<std::mutex> lock(gEnc.mutex);
+	while(true) {
+		gEnc.wake.wait(lock, []() { return gEnc.quit || !gEnc.jobs.empty(); });
+		if(gEnc.jobs.empty()) {
+			return;
+		}
+
+		std::function<void()> job = std::move(gEnc.jobs.front());
+		gEnc.jobs.pop_front();
+		gEnc.running++;
+		lock.unlock();
+		job();
+		lock.lock();
+		gEnc.running--;
+		if(gEnc.jobs.empty() && gEnc.running == 0) {
+			gEnc.idle.notify_all();
+		}
+	}
+}
+
+void EncodeAsync(std::function<void()> job) {
+	std::lock_guard<std::mutex> lock(gEnc.mutex);
+	if(gEnc.workers.empty()) {
+		// half the cores at most, rendering and the simulation keep the rest
+		unsigned int count = std::max(1u, std::min(4u, std::thread::hardware_concurrency() / 2));
+		gEnc.quit = false;
+		for(unsigned int i = 0; i < count; i++) {
+			gEnc.workers.emplace_back(worker);
+		}
+	}
+	gEnc.jobs.push_back(std::move(job));
+	gEnc.wake.notify_one();
+}
+
+void EncodeWait(void) {
+	std::unique_lock<std::mutex> lock(gEnc.mutex);
+	gEnc.idle.wait(lock, []() { return gEnc.jobs.empty() && gEnc.running == 0; });
+}
+
+void EncodeShutdown(void) {
+	std::vector<std::thread> workers;
+	{
+		std::lock_guard<std::mutex> lock(gEnc.mutex);
+		gEnc.quit = true;
+		workers.swap(gEnc.workers);
+	}
+	gEnc.wake.notify_all();
+	for(std::thread& thread : workers) {
+		thread.join();
+	}
+}
@@ -0,0 +1,15 @@
+#ifndef RLCAPTURE_H
+#define RLCAPTURE_H
+
+#include <functional>
+
+// Image writers, pixels are tightly packed 8 bit RGBA rows (BGRA when bgra is set), alpha is dropped
+bool WritePNG(const char* fileName, const unsigned char* pixels, int width, int height, bool bgra);  // Write an RGB PNG (stored deflate blocks, fast to write but uncompressed)
+bool WritePPM(const char* fileName, const unsigned char* pixels, int width, int height, bool bgra);  // Write a binary PPM (raw RGB after a short header)
+
+// Encoder pool, a few worker threads started on first use so encoding never runs on the render thread
+void EncodeAsync(std::function<void()> job);                    // Queue a job on the encoder pool
+void EncodeWait(void);                                          // Block until every queued job has finished
+void EncodeShutdown(void);                                      // Finish queued jobs and join the workers
+
+#endif
@@ -85,6 +85,47 @@ typedef struct Camera3D {
 
 typedef Camera3D Camera;    // Camera type fallback, defaults to Camera3D
 
+// GpuTimings, GPU time spent per pass of a frame, in milliseconds
+typedef struct GpuTimings {
+    float upload;           // Staging to device copies and compute passes (voxel expansion, culling)
+    float occlusion;        // Occlusion culling: first pass of last frame's visible bricks, depth pyramid and brick tests
+    float wires;            // Wire pass
+    float solids;           // Solid pass
+    float hud;              // Text overlay pass
+    float total;            // Whole frame command buffer, including barriers and MSAA resolve
+} GpuTimings;
+
+// StartupTimings, wall time from InitWindow to the first presented frame, in milliseconds
+typedef struct StartupTimings {
+    float window;           // GLFW and window creation
+    float device;           // Instance, device, queues and per-frame objects
+    float swapchain;        // Surface, swapchain and its MSAA and depth images
+    float init;             // Whole InitWindow call, pipelines are still building when it returns
+    float pipelines;        // Pipeline builds on worker threads, from the first start to the last finish
+    float pipelineWait;     // Time the first frame waited for pipelines still building
+    float firstFrame;       // From entering InitWindow until the first frame was presented
+    bool pipelineCacheHit;  // A pipeline cache matching this driver and device was loaded from disk
+} StartupTimings;
+
+// FramePacing, how SetTargetFPS held the frame rate, in milliseconds
+typedef struct FramePacing {
+    float sleep;            // Mean time slept per frame
+    float spin;             // Mean time spun per frame after waking up
+    float jitter;           // Mean absolute difference between the deadline and the moment the frame was released
+    float maxError;         // Latest release after a deadline
+    int presentMode;        // VkPresentModeKHR in use (0 immediate, 1 mailbox, 2 FIFO)
+} FramePacing;
+
+// CaptureStats, frames taken by TakeScreenshot and BeginFrameCapture since InitWindow
+typedef struct CaptureStats {
+    int captured;           // Frames copied into the readback ring
+    int written;            // Frames encoded and written to disk
+    int failed;             // Frames that could not be copied or written
+    int pending;            // Frames copied or being encoded, not on disk yet
+    int stalls;             // Captures that waited for a ring slot because encoding fell a whole ring behind
+    float encodeMs;         // Mean time a worker took to encode and write one frame
+} CaptureStats;
+
 // Camera projection
 typedef enum {
     CAMERA_PERSPECTIVE = 0,         // Perspective projection
@@ -241,7 +282,8 @@ typedef enum {
     FLAG_WINDOW_TRANSPARENT = 0x00000010,   // Set to allow transparent framebuffer
     FLAG_WINDOW_HIGHDPI = 0x00002000,   // Set to support HighDPI
     FLAG_MSAA_4X_HINT = 0x00000020,   // Set to try enabling MSAA 4X
-    FLAG_INTERLACED_HINT = 0x00010000    // Set to try enabling interlaced video format (for V3D)
+    FLAG_INTERLACED_HINT = 0x00010000,   // Set to try enabling interlaced video format (for V3D)
+    FLAG_WINDOW_HEADLESS = 0x00020000    // Set to render offscreen with no window, surface or swapchain (read frames back with GetFramePixels())
 } ConfigFlags;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,163 @@
+#include "rlprof.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+static constexpr uint64_t gRingSize = 1 << 14; // zones kept per thread, must be a power of two
+
+struct ProfileEvent {
+	const char* name;
+	uint64_t begin;
+	uint64_t end;
+};
+
+// single producer ring: only the owning thread writes, readers copy it and drop whatever the writer may have lapped
+struct ThreadRing {
+	uint32_t tid;
+	std::atomic<uint64_t> head;
+	ProfileEvent events[gRingSize];
+};
+
+static struct ProfilerGlobals {
+	std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+	std::mutex registry; // guards rings, taken once per thread and by readers
+	std::vector<ThreadRing*> rings;
+	std::string summary;
+} gProf;
+
+// rings are never freed so zones of finished threads can still be exported
+static thread_local ThreadRing* tRing = nullptr;
+
+static ThreadRing* getRing() {
+	if(!tRing) {
+		ThreadRing* ring = new ThreadRing;
+		ring->head.store(0, std::memory_order_relaxed);
+		std::lock_guard<std::mutex> lock(gProf.registry);
+		ring->tid = static_cast<uint32_t>(gProf.rings.size());
+		gProf.rings.push_back(ring);
+		tRing = ring;
+	}
+	return tRing;
+}
+
+static std::vector<ProfileEvent> readRing(const ThreadRing* ring) {
+	uint64_t head = ring->head.load(std::memory_order_acquire);
+	uint64_t first = head > gRingSize ? head - gRingSize : 0;
+
+	std::vector<ProfileEvent> events;
+	events.reserve(head - first);
+	for(uint64_t i = first; i < head; i++) {
+		events.push_back(ring->events[i & (gRingSize - 1)]);
+	}
+
+	// slots at or below the current head minus the ring size may have been rewritten while copying
+	uint64_t after = ring->head.load(std::memory_order_acquire);
+	if(after >= first + gRingSize) {
+		uint64_t stale = std::min<uint64_t>(after - gRingSize + 1 - first, events.size());
+		events.erase(events.begin(), events.begin() + stale);
+	}
+
+	return events;
+}
+
+uint64_t GetProfileTime(void) {
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gProf.epoch).count();
+}
+
+void ProfileRecord(const char* name, uint64_t begin, uint64_t end) {
+	ThreadRing* ring = getRing();
+	uint64_t head = ring->head.load(std::memory_order_relaxed);
+	ring->events[head & (gRingSize - 1)] = { name, begin, end };
+	ring->head.store(head + 1, std::memory_order_release);
+}
+
+ProfileZone::ProfileZone(const char* name) : name(name), begin(GetProfileTime()) {
+
+}
+
+ProfileZone::~ProfileZone() {
+	ProfileRecord(name, begin, GetProfileTime());
+}
+
+bool ExportProfileTrace(const char* fileName) {
+	std::ofstream file(fileName);
+	if(!file) {
+		return false;
+	}
+
+	std::vector<ThreadRing*> rings;
+	{
+		std::lock_guard<std::mutex> lock(gProf.registry);
+		rings = gProf.rings;
+	}
+
+	char line[256];
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+	for(const ThreadRing* ring : rings) {
+		snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"thread %u\"}}", first ? "" : ",\n", ring->tid, ring->tid);
+		file << line;
+		first = false;
+		for(const ProfileEvent& event : readRing(ring)) {
+			snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.name, ring->tid, event.begin / 1000.0, (event.end - event.begin) / 1000.0);
+			file << line;
+		}
+	}
+	file << "\n]}\n";
+
+	return static_cast<bool>(file);
+}
+
+const char* GetProfileSummary(double windowSeconds) {
+	struct Row {
+		const char* name;
+		uint64_t count;
+		uint64_t total;
+		uint64_t max;
+	};
+	std::vector<Row> rows;
+
+	std::vector<ThreadRing*> rings;
+	{
+		std::lock_guard<std::mutex> lock(gProf.registry);
+		rings = gProf.rings;
+	}
+
+	uint64_t now = GetProfileTime();
+	uint64_t window = static_cast<uint64_t>(windowSeconds * 1e9);
+	uint64_t since = now > window ? now - window : 0;
+	for(const ThreadRing* ring : rings) {
+		for(const ProfileEvent& event : readRing(ring)) {
+			if(event.end < since) {
+				continue;
+			}
+			auto row = std::find_if(rows.begin(), rows.end(), [&](const Row& r) { return strcmp(r.name, event.name) == 0; });
+			if(row == rows.end()) {
+				rows.push_back({ event.name, 0, 0, 0 });
+				row = rows.end() - 1;
+			}
+			uint64_t duration = event.end - event.begin;
+			row->count++;
+			row->total += duration;
+			row->max = std::max(row->max, duration);
+		}
+	}
+	std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.total > b.total; });
+
+	char line[128];
+	snprintf(line, sizeof(line), "%-24s %8s %10s %10s %7s\n", "zone", "calls", "mean ms", "max ms", "load %");
+	gProf.summary = line;
+	for(const Row& row : rows) {
+		snprintf(line, sizeof(line), "%-24s %8llu %10.3f %10.3f %7.1f\n", row.name, static_cast<unsigned long long>(row.count),
+			row.total / 1e6 / row.count, row.max / 1e6, 100.0 * row.total / std::max<uint64_t>(window, 1));
+		gProf.summary += line;
+	}
+
+	return gProf.summary.c_str();
+}
@@ -0,0 +1,30 @@
+#ifndef RLPROF_H
+#define RLPROF_H
+
+#include <cstdint>
+
+// Scoped profiler zone, records [construction, destruction) on the calling thread's ring buffer
+// NOTE: name must outlive the profiler (use string literals)
+struct ProfileZone {
+    const char* name;
+    uint64_t begin;
+    explicit ProfileZone(const char* name);
+    ~ProfileZone();
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+#define RLPROF_CONCAT_(a, b) a##b
+#define RLPROF_CONCAT(a, b) RLPROF_CONCAT_(a, b)
+#ifdef RLVK_DISABLE_PROFILER
+#define PROFILE_ZONE(name)
+#else
+#define PROFILE_ZONE(name) ProfileZone RLPROF_CONCAT(profileZone, __LINE__)(name)
+#endif
+
+uint64_t GetProfileTime(void);                                  // Get profiler clock in nanoseconds (monotonic)
+void ProfileRecord(const char* name, uint64_t begin, uint64_t end); // Record a zone with explicit timestamps on the calling thread
+bool ExportProfileTrace(const char* fileName);                  // Write recorded zones as Chrome/Perfetto trace JSON
+const char* GetProfileSummary(double windowSeconds);            // Get per-zone count, mean and max time over the last windowSeconds
+
+#endif
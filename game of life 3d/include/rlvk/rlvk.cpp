@@ -1,14 +1,36 @@
 #include "rlvk.hpp"
+#include "rlprof.hpp"
+#include "rlcapture.hpp"
 #include "gtc/matrix_transform.hpp"
 #include <cmath>
 #include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <bitset>
+#include <cstdarg>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <atomic>
+#include <string>
+#include <cstring>
 
 #include "solid.h"
+#include "face.h"
 #include "wire.h"
 #include "cube.h"
+#include "text.h"
+#include "glyph.h"
+#include "density.h"
+#include "square.h"
+#include "voxel.h"
+#include "cull.h"
+#include "hiz.h"
+#include "bricks.h"
+#include "screen.h"
+#include "march.h"
 
 #define VK_NO_PROTOTYPES
 #include "vulkan.h"
@@ -16,7 +38,72 @@
 #include "glfw3.h"
 #include "vk_format_utils.h"
 
+// windows.h would clash with DrawText and CloseWindow, the timer resolution calls are all that is needed from winmm
+#if defined(_WIN32)
+#pragma comment(lib, "winmm.lib")
+extern "C" __declspec(dllimport) unsigned int __stdcall timeBeginPeriod(unsigned int uPeriod);
+extern "C" __declspec(dllimport) unsigned int __stdcall timeEndPeriod(unsigned int uPeriod);
+#endif
+
 static constexpr int gFramesInFlight = 2;
+static constexpr VkDeviceSize gStagingBlockSize = 8 << 20; // first upload block of each frame slot, each chained block doubles the last
+static constexpr uint32_t gCubeChunk = 4096;     // cubes in the first upload chunk of a draw stream, later chunks match the stream so far
+static constexpr int gCellCapacity = 50 * 50 * 50;  // retained cell instances the buffers start with, they double whenever they fill up
+static constexpr int gCellAxis = 1024;          // retained cell coordinates are packed in 10 bits each
+static constexpr int gMaxCells = 50 * 50 * 50;  // voxel grid cells
+static constexpr int gMaxVoxelWords = (gMaxCells + 31) / 32;
+static constexpr int gVoxelBrick = 4;           // voxel.comp workgroup edge, the unit of occlusion culling
+static constexpr int gMaxBricks = gMaxCells;    // every brick holds at least one cell
+static constexpr int gVoxelLods = 3;            // cells, 2x2x2 blocks and whole bricks
+static constexpr int gMaxLodCubes = 2 * gMaxCells;  // every block and brick holds at least one cell
+static constexpr int gMaxHizLevels = 16;
+static constexpr int gPaletteSize = 256;        // colors of a DrawVoxelGridShaded palette
+static constexpr int gMaxDensitySquares = 512 * 512;
+static constexpr int gDirtyGap = 16;            // clean instances worth re-uploading to merge two dirty ranges into one copy
+static constexpr int gMaxGlyphs = 4096;         // glyphs drawn per frame, extra text is dropped
+static constexpr int gFrameTimeSamples = 256;   // frame times kept for GetFPS and the DrawFPS percentiles
+static constexpr double gMinSleepSlack = 0.0005; // seconds always left to the spin after a sleep
+static constexpr int gCaptureSlots = 8;         // capture readback ring, the frames in flight plus room for encoding to fall behind
+static constexpr const char* gPipelineCacheFile = "pipeline_cache.bin";  // relative to the working directory
+
+static const uint16_t gIndices[] = {
+	// solid.vert quads 0 to 2, the three faces toward the eye
+	0, 1, 2, 3, 2, 1, 4, 5, 6, 7, 6, 5, 8, 9, 10, 11, 10, 9,
+	// solid.vert quads 3 to 8, all six faces
+	12, 13, 14, 15, 14, 13, 16, 17, 18, 19, 18, 17, 20, 21, 22, 23, 22, 21,
+	24, 25, 26, 27, 26, 25, 28, 29, 30, 31, 30, 29, 32, 33, 34, 35, 34, 33,
+	// wire cube, 12 lines between corners numbered with bit 0 for +x, bit 1 for +y and bit 2 for +z
+	0, 1, 0, 2, 0, 4, 1, 3, 1, 5, 3, 7, 5, 7, 4, 5, 2, 3, 2, 6, 4, 6, 6, 7,
+	// one quad of face.vert, 2 triangles
+	0, 1, 2, 3, 2, 1
+};
+
+// first index of each shape in gIndices
+enum {
+	INDEX_SOLID_VISIBLE = 0,
+	INDEX_SOLID_ALL = 18,
+	INDEX_WIRE = 54,
+	INDEX_FACE = 78
+};
+
+// timestamp slots written every frame
+enum {
+	TIMESTAMP_BEGIN,
+	TIMESTAMP_UPLOAD,
+	TIMESTAMP_OCCLUSION,
+	TIMESTAMP_WIRES,
+	TIMESTAMP_SOLIDS,
+	TIMESTAMP_HUD,
+	TIMESTAMP_END,
+	TIMESTAMP_COUNT
+};
+
+// states of a capture slot, only the encoder moves one from CAPTURE_ENCODING back to CAPTURE_FREE
+enum {
+	CAPTURE_FREE,
+	CAPTURE_COPYING,    // recorded, waiting for the fence of the frame that copies into it
+	CAPTURE_ENCODING    // handed to the encoder pool
+};
 
 static struct Image {
 	VkDeviceMemory memory = {};
@@ -27,16 +114,35 @@ static struct Image {
 struct Buffer {
 	VkDeviceMemory memory = {};
 	VkBuffer buffer = {};
-	union {
-		void* hostPtr = nullptr;
-		VkDeviceAddress devicePtr;
-	};
+	VkDeviceSize size = 0;
+	void* hostPtr = nullptr;        // set when the memory is host visible
+	VkDeviceAddress devicePtr = 0;  // set when created with SHADER_DEVICE_ADDRESS usage
+};
+
+// a suballocated range of the current frame slot's upload blocks, valid until that slot's fence is waited on again
+static struct StagingRange {
+	VkBuffer buffer;
+	VkDeviceSize offset;
+	char* hostPtr;
+	VkDeviceAddress devicePtr;  // only with direct upload, shaders can then read the range in place
 };
 
 static struct PushConstants {
 	VkDeviceAddress buf;
 	uint32_t offs;
+	glm::mat4 trans;        // text only, the 3D shaders read the camera from view
+	glm::vec3 eye;
+	VkDeviceAddress view;
+	VkDeviceAddress grid;   // CellGrid when buf holds packed cells instead of cubes
+};
+
+// the camera of a frame, written to the slot's mapped view buffer right before submission so input sampled after recording still counts
+static struct FrameView {
 	glm::mat4 trans;
+	glm::vec4 planes[6];
+	glm::vec3 eye;
+	float pixelScale;       // pixels covered by one unit at distance one, zero when level of detail is off
+	glm::mat4 inverse;      // of trans, march.frag unprojects its rays with it
 };
 
 static struct Cube {
@@ -45,15 +151,166 @@ static struct Cube {
 	glm::u8vec4 color;
 };
 
+// what a packed cell ({ x | y << 10 | z << 20, shade }) is decoded against, cell (x, y, z) is centered at pos + (x, y, z) * size
+static struct CellGrid {
+	glm::vec3 pos;
+	float size;
+	glm::u8vec4 wire;       // DrawCellInstanceWires color
+	glm::u8vec4 palette[gPaletteSize];
+};
+
+// the cull pass counts its survivors into the solid command, a copy hands the count to the wire command
+static struct CellCommand {
+	VkDrawIndexedIndirectCommand solid;
+	VkDrawIndexedIndirectCommand wire;
+};
+
+// immediate cubes written straight into upload chunks, copied to g.cubes chunk by chunk at EndDrawing
+static struct CubeStream {
+	struct Chunk {
+		VkBuffer buffer;
+		VkDeviceSize offset;
+		VkDeviceAddress devicePtr;
+		uint32_t count;
+	};
+	std::vector<Chunk> chunks;
+	Cube* head;
+	Cube* end;
+	uint32_t count;
+};
+
+static struct VoxelConstants {
+	VkDeviceAddress bits;
+	VkDeviceAddress cubes;
+	VkDeviceAddress cmd;
+	glm::ivec3 dims;
+	float size;
+	glm::vec3 pos;
+	glm::u8vec4 inner;
+	glm::u8vec4 outer;
+	uint32_t faces;
+	VkDeviceAddress bricks;
+	VkDeviceAddress shades;
+	VkDeviceAddress lod;
+	uint32_t shaded;
+	uint32_t lodCubes;      // first block or brick cube, after room for every cell
+	uint32_t lodFaces;      // first block or brick face, in words like faces
+};
+
+// planes as dot(plane.xyz, p) + plane.w >= 0 inside
+static struct CullConstants {
+	VkDeviceAddress src;
+	VkDeviceAddress dst;
+	VkDeviceAddress cmd;
+	uint32_t count;
+	VkDeviceAddress view;
+	VkDeviceAddress grid;
+};
+
+// phase 0 lists last frame's visible bricks, phase 1 tests all of them against the depth pyramid,
+// phase 2 lists every brick in the frustum when only the level of detail needs choosing
+static struct BrickConstants {
+	VkDeviceAddress bricks;
+	VkDeviceAddress hiz;
+	VkDeviceAddress draws;
+	VkDeviceAddress view;
+	glm::ivec3 dims;
+	float size;
+	glm::vec3 pos;
+	uint32_t phase;
+};
+
+// what march.frag reads of the voxel grid, one per frame slot since it points at the slot's view
+static struct MarchConstants {
+	VkDeviceAddress tiles;
+	VkDeviceAddress shades;
+	VkDeviceAddress view;
+	glm::ivec3 dims;
+	float size;
+	glm::vec3 pos;
+	glm::u8vec4 inner;
+	glm::u8vec4 outer;
+	uint32_t shaded;
+};
+
+// per brick face range of each level of detail written by voxel.comp and visibility written by bricks.comp
+static struct Brick {
+	uint32_t first[gVoxelLods];
+	uint32_t count[gVoxelLods];
+	uint32_t visible;
+};
+
+// counts of the two brick command lists, followed by the phase 0 commands and then the phase 1 commands
+static struct BrickDraws {
+	uint32_t early;
+	uint32_t late;
+	uint32_t indexCount;
+	uint32_t firstIndex;
+};
+
+static struct HizConstants {
+	VkDeviceAddress src;
+	VkDeviceAddress dst;
+	glm::ivec2 srcSize;
+	glm::ivec2 dstSize;
+};
+
+// offset in floats after the header
+static struct HizLevel {
+	uint32_t offset;
+	int32_t width;
+	int32_t height;
+};
+
+// start of the depth pyramid buffer, level 0 is a copy of the depth buffer and the levels follow it
+static struct HizHeader {
+	uint32_t count;
+	HizLevel levels[gMaxHizLevels];
+};
+
+// indirect draw of the visible voxel faces, followed by the number of cubes the expansion pass wrote and the same for blocks and bricks
+static struct VoxelCommand {
+	VkDrawIndexedIndirectCommand draw;
+	uint32_t cubes;
+	uint32_t lodCubes;
+	uint32_t lodFaces;
+};
+
+// start of a density map, one alpha byte per square follows
+static struct DensityHeader {
+	glm::ivec2 dims;
+	glm::vec3 pos;
+	float size;
+	glm::u8vec4 color;
+};
+
+// one instanced quad of the text overlay, position and size in pixels
+static struct Glyph {
+	glm::vec2 pos;
+	float size;
+	uint32_t code;
+	glm::u8vec4 color;
+};
+
 static struct Globals {
 	// windowing
 	int width, height;
 	GLFWwindow* win;
 	unsigned int windowFlags;
+	bool headless;      // FLAG_WINDOW_HEADLESS, no window, surface or swapchain, frames go to the offscreen image
+	bool readFrames;    // GetFramePixels() was called, headless frames are copied to host memory from then on
 
 	// timing
 	double frameTime;
 	double curTime;
+	float frameTimes[gFrameTimeSamples];
+	uint64_t frameSamples;
+
+	// frame limiter, sleeps until sleepSlack before the deadline and spins the rest
+	double sleepSlack;      // worst recent oversleep, decays so one hiccup does not force spinning forever
+	float paceSleep[gFrameTimeSamples];
+	float paceSpin[gFrameTimeSamples];
+	float paceError[gFrameTimeSamples];  // release time minus deadline, 0 for frames that missed it anyway
 
 	//input
 	double scroll;
@@ -66,8 +323,11 @@ static struct Globals {
 	VkInstance inst;
 	VkPhysicalDevice pDev;
 	VkPhysicalDeviceMemoryProperties mProps;
+	bool directUpload;  // upload blocks are device local, per frame instances are drawn from them without a copy
 	VkDevice lDev;
 	uint32_t fam;
+	uint32_t timestampBits;
+	float timestampPeriod;
 	VkQueue q;
 	VkSurfaceKHR surf;
 	VkSurfaceFormatKHR surfformat;
@@ -77,10 +337,25 @@ static struct Globals {
 	std::vector<VkImageView> views;
 	Image msaa;
 	Image ds;
+	Image depthResolve;     // single sampled copy of an MSAA depth buffer for the pyramid
+	Image offscreen;        // headless color target, stands in for the swapchain image
+	VkResolveModeFlagBits depthResolveMode;
 	uint32_t img;
 	VkPipelineLayout layout;
 	VkPipeline wirePipe;
 	VkPipeline solidPipe;
+	VkPipeline facePipe;
+	VkPipeline textPipe;
+	VkPipeline densityPipe;
+	VkPipelineLayout computeLayout;
+	VkPipeline voxelPipe;
+	VkPipeline cullPipe;
+	VkPipeline hizPipe;
+	VkPipeline brickPipe;
+	VkPipeline marchPipe;
+	VkPipelineCache pipelineCache;
+	std::vector<std::thread> pipelineBuilds;    // joined before the first frame is recorded
+	VkPhysicalDeviceProperties deviceProps;
 
 	struct {
 		VkCommandPool cmdPool;
@@ -88,18 +363,115 @@ static struct Globals {
 		VkSemaphore acquireSem;
 		VkSemaphore presentSem;
 		VkFence fence;
+		VkQueryPool queryPool;
+		bool timed;
+		Buffer view;    // FrameView, host visible
+		Buffer march;   // MarchConstants, host visible
+		Buffer readback;    // headless only, the slot's frame as RGBA8 rows, host visible, created once GetFramePixels() is first called
+		bool readBack;      // the slot's frame was copied into readback
+
+		// host visible upload blocks, filled front to back while recording and reclaimed by the fence
+		std::vector<Buffer> staging;
+		size_t stagingBlock;
+		VkDeviceSize stagingHead;
+		std::vector<Buffer> garbage;    // buffers replaced while recording this slot, destroyed once its fence signals
 	} perFrame[gFramesInFlight];
 	uint64_t idx;
 
-	std::vector<Cube> solids;
-	std::vector<Cube> wires;
+	CubeStream solids;
+	CubeStream wires;
+	std::vector<Glyph> glyphs;
+
+	// retained cell instances, packed grid cells kept dense so slots [0, cells.size()) are exactly the live instances
+	std::vector<glm::uvec2> cells;  // x | y << 10 | z << 20 and the palette index
+	std::vector<int> cellIds;       // slot -> id
+	std::vector<int> cellSlots;     // id -> slot, -1 when absent
+	std::vector<uint32_t> dirtyCells;
+	bool drawCells;
+	bool drawCellWires;
+	bool gpuCulling;
+	CellGrid cellGrid;
+	bool cellGridDirty;
+
+	// occupancy mask of the voxel grid, expanded into cubes on the GPU when it changes
+	std::vector<uint32_t> voxelBits;
+	std::vector<uint8_t> voxelShades;   // palette followed by one index per cell, empty when colored by the gradient
+	std::vector<uint8_t> voxelLod;      // live cells per 2x2x2 block followed by live cells per brick, updated from the changed bits
+	std::vector<uint32_t> voxelTiles;   // the occupancy bits again as two words per brick, for march.frag
+	std::vector<uint32_t> dirtyTiles;   // bricks whose tile changed since the last upload
+	bool voxelTilesStale;               // the whole tile buffer needs uploading
+	bool voxelShadesDirty;
+	VoxelConstants voxel;
+
+	// ground density map, header and alpha bytes as uploaded
+	std::vector<uint8_t> densityMap;
+	bool densityDirty;
+	bool drawDensity;
+	bool voxelDirty;
+	bool drawVoxels;
+	bool voxelBricksStale;  // visibility history belongs to other dimensions
+	bool occlusionCulling;
+	bool lod;
+	bool rayMarching;
+	bool firstInstanceDraws;    // drawIndirectFirstInstance and multiDrawIndirect, which the per-brick draws of occlusion culling and LOD need
+	HizHeader hiz;
 
-	Buffer staging[gFramesInFlight];
 	Buffer cubes;
+	Buffer indices;
+	Buffer cellBuffer;
+	Buffer cellVisible;
+	Buffer cellCommand;
+	Buffer cellGridBuffer;
+	Buffer voxelBitBuffer;
+	Buffer voxelShadeBuffer;
+	Buffer voxelLodBuffer;
+	Buffer voxelTileBuffer;
+	Buffer densityBuffer;
+	Buffer voxelCubes;
+	Buffer voxelCommand;
+	Buffer voxelBricks;
+	Buffer brickDraws;
+	Buffer hizBuffer;
 
 	VkClearColorValue col;
 
 	glm::mat4 transform;
+	glm::vec3 eye;
+	float pixelScale;
+	bool cullDisabled;
+
+	GpuTimings gpuTimings;
+
+	// late latching, the camera is re-evaluated with input polled right before submission
+	Camera3D camera = Camera3D(0);  // as given to BeginMode3D
+	Camera3D (*latch)(Camera3D camera);
+	double inputTime;                       // when input was last polled
+	float inputLatency[gFrameTimeSamples];  // input poll to submission of the frame it positioned
+
+	// frame capture, finished frames are copied into a ring of host visible buffers and encoded on the pool once their fence has signalled
+	struct {
+		Buffer buffer;
+		std::atomic<int> state;
+		uint64_t frame;     // g.idx of the frame copied into it
+		int width, height;
+		bool bgra;
+		std::string fileName;
+	} captureSlots[gCaptureSlots];
+	uint32_t captureHead;
+	bool swapCopyable;              // swapchain images can be a transfer source
+	std::string screenshot;         // written from the next frame, empty when none is asked for
+	std::string captureFormat;      // file name format of a running capture, empty when stopped
+	int captureFrame;               // number passed to captureFormat
+	int captured;
+	int captureStalls;
+	std::atomic<int> captureWritten;
+	std::atomic<int> captureFailed;
+	std::atomic<uint64_t> captureEncodeTime;
+
+	StartupTimings startup;
+	uint64_t initBegin;
+	uint64_t pipelinesBegin;
+	std::atomic<uint64_t> pipelinesEnd;     // latest finish of any pipeline build
 } g = { 0 };
 
 void SetConfigFlags(unsigned int flags) {
@@ -110,6 +482,61 @@ void SetTargetFPS(int fps) {
 	g.frameTime = 1.0 / fps;
 }
 
+// seconds since InitWindow, glfw's clock is not available without a window
+static double getTime() {
+	return (GetProfileTime() - g.initBegin) / 1e9;
+}
+
+// FIFO is the only mode that waits for vblank, otherwise mailbox keeps latency low without tearing where it exists
+static VkPresentModeKHR choosePresentMode() {
+	if(g.windowFlags & FLAG_VSYNC_HINT) {
+		return VK_PRESENT_MODE_FIFO_KHR;
+	}
+
+	uint32_t count = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(g.pDev, g.surf, &count, nullptr);
+	std::vector<VkPresentModeKHR> modes(count);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(g.pDev, g.surf, &count, modes.data());
+
+	if(std::find(modes.begin(), modes.end(), VK_PRESENT_MODE_MAILBOX_KHR) != modes.end()) {
+		return VK_PRESENT_MODE_MAILBOX_KHR;
+	}
+	if(std::find(modes.begin(), modes.end(), VK_PRESENT_MODE_IMMEDIATE_KHR) != modes.end()) {
+		return VK_PRESENT_MODE_IMMEDIATE_KHR;
+	}
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+// returns when the frame deadline is reached, sleeping for most of the wait so the core is free for other threads
+static void waitForDeadline(double deadline) {
+	const uint64_t slot = g.frameSamples % gFrameTimeSamples;
+	double time = getTime();
+	g.paceSleep[slot] = 0.0f;
+	g.paceSpin[slot] = 0.0f;
+	g.paceError[slot] = 0.0f;
+	if(time >= deadline) {
+		return;
+	}
+
+	if(deadline - time > g.sleepSlack) {
+		double request = deadline - time - g.sleepSlack;
+		double before = time;
+		std::this_thread::sleep_for(std::chrono::duration<double>(request));
+		time = getTime();
+		g.paceSleep[slot] = static_cast<float>(time - before);
+
+		double oversleep = (time - before) - request;
+		g.sleepSlack = std::max({ gMinSleepSlack, oversleep, g.sleepSlack * 0.99 });
+	}
+
+	double spinBegin = time;
+	while(time < deadline) {
+		time = getTime();
+	}
+	g.paceSpin[slot] = static_cast<float>(time - spinBegin);
+	g.paceError[slot] = static_cast<float>(time - deadline);
+}
+
 inline glm::mat4 perspective(float fovy, float aspect, float zNear) {
 	float f = 1.0f / tanf(fovy * 0.5f);
 	return glm::mat4(
@@ -120,12 +547,69 @@ inline glm::mat4 perspective(float fovy, float aspect, float zNear) {
 	);
 }
 
+// frustum planes of a view-projection matrix with Vulkan clip conventions, the far plane of an infinite projection keeps everything
+static void frustumPlanes(const glm::mat4& m, glm::vec4* planes) {
+	glm::vec4 rows[4];
+	for(int i = 0; i < 4; i++) {
+		rows[i] = glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]);
+	}
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[2];
+	planes[5] = rows[3] - rows[2];
+}
+
+static void setCamera(Camera3D camera) {
+	g.transform = perspective(glm::radians(camera.fovy), static_cast<float>(g.width) / g.height, 0.01f) * glm::lookAt(camera.position, camera.target, camera.up);
+	g.eye = camera.position;
+	g.pixelScale = g.height * 0.5f / tanf(glm::radians(camera.fovy) * 0.5f);
+}
+
+// the previous state becomes what the application saw this frame, so input arriving during a latch is still seen by the next frame
+static void pollInput() {
+	g.scroll = 0.0;
+	g.prevMousePos = g.mousePos;
+	memcpy(&g.prevKeys, &g.keys, sizeof(g.keys));
+
+	if(!g.headless) {
+		glfwPollEvents();
+	}
+	g.inputTime = getTime();
+}
+
+static void writeView() {
+	FrameView* view = reinterpret_cast<FrameView*>(g.perFrame[g.idx % gFramesInFlight].view.hostPtr);
+	view->trans = g.transform;
+	frustumPlanes(g.transform, view->planes);
+	view->eye = g.eye;
+	view->pixelScale = g.lod ? g.pixelScale : 0.0f;
+	view->inverse = glm::inverse(g.transform);
+}
+
 static uint32_t getMemoryIndex(VkMemoryPropertyFlags flags, uint32_t mask) {
 	for(uint32_t idx = 0; idx < g.mProps.memoryTypeCount; idx++) {
 		if(((1 << idx) & mask) && (g.mProps.memoryTypes[idx].propertyFlags & flags) == flags) {
 			return idx;
 		}
 	}
+	return ~0u;
+}
+
+// true on UMA, software rasterizers and resizable BAR, where a host visible type spans the largest device local heap.
+// a small BAR window (typically 256 MiB) does not count, per frame uploads could exhaust it
+static bool hasDirectUploadMemory() {
+	VkDeviceSize largestHeap = 0;
+	for(uint32_t idx = 0; idx < g.mProps.memoryHeapCount; idx++) {
+		if(g.mProps.memoryHeaps[idx].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+			largestHeap = std::max(largestHeap, g.mProps.memoryHeaps[idx].size);
+		}
+	}
+
+	const VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	uint32_t idx = getMemoryIndex(flags, ~0u);
+	return idx < g.mProps.memoryTypeCount && g.mProps.memoryHeaps[g.mProps.memoryTypes[idx].heapIndex].size >= largestHeap;
 }
 
 static Image createImage(uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage, bool msaa) {
@@ -161,6 +645,15 @@ static Image createImage(uint32_t width, uint32_t height, VkFormat format, VkIma
 	return image;
 }
 
+// for buffers the GPU writes and the CPU reads, cached where there is any
+static VkMemoryPropertyFlags readbackMemory() {
+	VkMemoryPropertyFlags flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	if(getMemoryIndex(flags | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, ~0u) != ~0u) {
+		flags |= VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	}
+	return flags;
+}
+
 static void destroyImage(Image image) {
 	vkDestroyImageView(g.lDev, image.view, nullptr);
 	vkDestroyImage(g.lDev, image.image, nullptr);
@@ -169,6 +662,7 @@ static void destroyImage(Image image) {
 
 Buffer createBuffer(uint64_t size, VkBufferUsageFlags usage, VkMemoryPropertyFlags memProps) {
 	Buffer buffer;
+	buffer.size = size;
 
 	VkBufferCreateInfo ci = {};
 	ci.size = size;
@@ -192,7 +686,7 @@ Buffer createBuffer(uint64_t size, VkBufferUsageFlags usage, VkMemoryPropertyFla
 	if(memProps & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
 		vkMapMemory(g.lDev, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.hostPtr);
 	}
-	else if(usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
+	if(usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) {
 		VkBufferDeviceAddressInfo da = {};
 		da.buffer = buffer.buffer;
 		buffer.devicePtr = vkGetBufferDeviceAddress(g.lDev, &da);
@@ -206,8 +700,327 @@ void destroyBuffer(Buffer buffer) {
 	vkFreeMemory(g.lDev, buffer.memory, nullptr);
 }
 
+static StagingRange stagingAlloc(VkDeviceSize size) {
+	auto& frame = g.perFrame[g.idx % gFramesInFlight];
+
+	// 16 byte aligned so any upload can start at the returned offset
+	frame.stagingHead = (frame.stagingHead + 15) & ~VkDeviceSize(15);
+	while(frame.stagingBlock < frame.staging.size() && frame.stagingHead + size > frame.staging[frame.stagingBlock].size) {
+		frame.stagingBlock++;
+		frame.stagingHead = 0;
+	}
+	if(frame.stagingBlock == frame.staging.size()) {
+		VkDeviceSize blockSize = frame.staging.empty() ? gStagingBlockSize : frame.staging.back().size * 2;
+		if(g.directUpload) {
+			frame.staging.push_back(createBuffer(std::max(blockSize, size), VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+		}
+		else {
+			frame.staging.push_back(createBuffer(std::max(blockSize, size), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+		}
+		frame.stagingHead = 0;
+	}
+
+	const Buffer& block = frame.staging[frame.stagingBlock];
+	StagingRange range = { block.buffer, frame.stagingHead, reinterpret_cast<char*>(block.hostPtr) + frame.stagingHead, block.devicePtr ? block.devicePtr + frame.stagingHead : 0 };
+	frame.stagingHead += size;
+	return range;
+}
+
+// copies size bytes from the host into dst at dstOffset through the upload blocks
+static void stagedUpload(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+	StagingRange range = stagingAlloc(size);
+	memcpy(range.hostPtr, data, size);
+
+	VkBufferCopy bc = {};
+	bc.srcOffset = range.offset;
+	bc.dstOffset = dstOffset;
+	bc.size = size;
+	vkCmdCopyBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, range.buffer, dst, 1, &bc);
+}
+
+static void pushCube(CubeStream& stream, const Cube& cube) {
+	if(stream.head == stream.end) {
+		uint32_t capacity = std::max(gCubeChunk, stream.count);
+		StagingRange range = stagingAlloc(capacity * sizeof(Cube));
+		stream.chunks.push_back({ range.buffer, range.offset, range.devicePtr, 0 });
+		stream.head = reinterpret_cast<Cube*>(range.hostPtr);
+		stream.end = stream.head + capacity;
+	}
+	*stream.head++ = cube;
+	stream.chunks.back().count++;
+	stream.count++;
+}
+
+// copies every chunk of the stream to dst back to back starting at dstOffset
+static void copyCubes(const CubeStream& stream, VkBuffer dst, VkDeviceSize dstOffset) {
+	for(const CubeStream::Chunk& chunk : stream.chunks) {
+		VkBufferCopy bc = {};
+		bc.srcOffset = chunk.offset;
+		bc.dstOffset = dstOffset;
+		bc.size = chunk.count * sizeof(Cube);
+		vkCmdCopyBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, chunk.buffer, dst, 1, &bc);
+		dstOffset += bc.size;
+	}
+}
+
+// with direct upload every chunk is drawn where it was written, otherwise the stream was copied to g.cubes at instance offs
+static void drawCubes(const CubeStream& stream, PushConstants pcs, uint32_t offs, uint32_t indexCount, uint32_t firstIndex) {
+	if(g.directUpload) {
+		for(const CubeStream::Chunk& chunk : stream.chunks) {
+			pcs.buf = chunk.devicePtr;
+			pcs.offs = 0;
+			vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+			vkCmdDrawIndexed(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, indexCount, chunk.count, firstIndex, 0, 0);
+		}
+	}
+	else if(stream.count > 0) {
+		pcs.buf = g.cubes.devicePtr;
+		pcs.offs = offs;
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+		vkCmdDrawIndexed(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, indexCount, stream.count, firstIndex, 0, 0);
+	}
+}
+
+static void resetCubes(CubeStream& stream) {
+	stream.chunks.clear();
+	stream.head = nullptr;
+	stream.end = nullptr;
+	stream.count = 0;
+}
+
+// the header layout is fixed by the spec, a cache written by another driver or device is dropped rather than handed to this one
+static std::vector<char> loadPipelineCache() {
+	std::ifstream file(gPipelineCacheFile, std::ios::binary | std::ios::ate);
+	if(!file) {
+		return {};
+	}
+	std::vector<char> data(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	if(!file.read(data.data(), data.size()) || data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) {
+		return {};
+	}
+
+	VkPipelineCacheHeaderVersionOne header;
+	memcpy(&header, data.data(), sizeof(header));
+	if(header.headerSize < sizeof(header) || header.headerSize > data.size() || header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+		header.vendorID != g.deviceProps.vendorID || header.deviceID != g.deviceProps.deviceID ||
+		memcmp(header.pipelineCacheUUID, g.deviceProps.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+		return {};
+	}
+	return data;
+}
+
+// written next to the old file and renamed over it, so a run killed mid-write never leaves a truncated cache behind
+static void savePipelineCache() {
+	size_t size = 0;
+	if(vkGetPipelineCacheData(g.lDev, g.pipelineCache, &size, nullptr) != VK_SUCCESS || size == 0) {
+		return;
+	}
+	std::vector<char> data(size);
+	if(vkGetPipelineCacheData(g.lDev, g.pipelineCache, &size, data.data()) != VK_SUCCESS) {
+		return;
+	}
+
+	std::string temp = std::string(gPipelineCacheFile) + ".tmp";
+	{
+		std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+		if(!file.write(data.data(), size)) {
+			return;
+		}
+	}
+	std::remove(gPipelineCacheFile);
+	std::rename(temp.c_str(), gPipelineCacheFile);
+}
+
+static VkShaderModule createShaderModule(const uint32_t* code, size_t words) {
+	VkShaderModuleCreateInfo ci = {};
+	ci.codeSize = words * sizeof(uint32_t);
+	ci.pCode = code;
+
+	VkShaderModule module;
+	vkCreateShaderModule(g.lDev, &ci, nullptr, &module);
+	return module;
+}
+
+// every pipeline shares the same blended color target, dynamic viewport, scissor and cull mode, and reverse-Z depth
+static VkPipeline createGraphicsPipeline(const uint32_t* vert, size_t vertWords, const uint32_t* frag, size_t fragWords, VkPrimitiveTopology topology, bool depthTest, bool depthWrite) {
+	VkPipelineRenderingCreateInfo ri = {};
+	ri.colorAttachmentCount = 1;
+	ri.pColorAttachmentFormats = &g.surfformat.format;
+	ri.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+
+	VkPipelineShaderStageCreateInfo si[2] = {};
+	si[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+	si[0].module = createShaderModule(vert, vertWords);
+	si[0].pName = "main";
+
+	si[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+	si[1].module = createShaderModule(frag, fragWords);
+	si[1].pName = "main";
+
+	VkPipelineVertexInputStateCreateInfo vi = {};
+
+	VkPipelineInputAssemblyStateCreateInfo ii = {};
+	ii.topology = topology;
+
+	VkPipelineViewportStateCreateInfo vpi = {};
+	vpi.viewportCount = 1;
+	vpi.scissorCount = 1;
+
+	VkPipelineRasterizationStateCreateInfo rai = {};
+	rai.cullMode = VK_CULL_MODE_BACK_BIT;
+	rai.lineWidth = 1.0f;
+
+	VkPipelineMultisampleStateCreateInfo mi = {};
+	mi.rasterizationSamples = (g.windowFlags & FLAG_MSAA_4X_HINT) ? VK_SAMPLE_COUNT_4_BIT : VK_SAMPLE_COUNT_1_BIT;
+
+	VkPipelineDepthStencilStateCreateInfo di = {};
+	di.depthTestEnable = depthTest;
+	di.depthWriteEnable = depthWrite;
+	di.depthCompareOp = VK_COMPARE_OP_GREATER;
+
+	VkPipelineColorBlendAttachmentState as = {};
+	as.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+	as.blendEnable = true;
+	as.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+	as.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+	as.colorBlendOp = VK_BLEND_OP_ADD;
+	as.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	as.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	as.alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkPipelineColorBlendStateCreateInfo bi = {};
+	bi.attachmentCount = 1;
+	bi.pAttachments = &as;
+
+	VkDynamicState ds[3] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR, VK_DYNAMIC_STATE_CULL_MODE };
+
+	VkPipelineDynamicStateCreateInfo dsi = {};
+	dsi.dynamicStateCount = 3;
+	dsi.pDynamicStates = ds;
+
+	VkGraphicsPipelineCreateInfo ci = {};
+	ci.pNext = &ri;
+	ci.stageCount = 2;
+	ci.pStages = si;
+	ci.pVertexInputState = &vi;
+	ci.pInputAssemblyState = &ii;
+	ci.pViewportState = &vpi;
+	ci.pRasterizationState = &rai;
+	ci.pMultisampleState = &mi;
+	ci.pDepthStencilState = &di;
+	ci.pColorBlendState = &bi;
+	ci.pDynamicState = &dsi;
+	ci.layout = g.layout;
+
+	VkPipeline pipeline;
+	vkCreateGraphicsPipelines(g.lDev, g.pipelineCache, 1, &ci, nullptr, &pipeline);
+
+	vkDestroyShaderModule(g.lDev, si[0].module, nullptr);
+	vkDestroyShaderModule(g.lDev, si[1].module, nullptr);
+	return pipeline;
+}
+
+static VkPipeline createComputePipeline(const uint32_t* code, size_t words) {
+	VkComputePipelineCreateInfo ci = {};
+	ci.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	ci.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	ci.stage.module = createShaderModule(code, words);
+	ci.stage.pName = "main";
+	ci.layout = g.computeLayout;
+
+	VkPipeline pipeline;
+	vkCreateComputePipelines(g.lDev, g.pipelineCache, 1, &ci, nullptr, &pipeline);
+
+	vkDestroyShaderModule(g.lDev, ci.stage.module, nullptr);
+	return pipeline;
+}
+
+// builds on a worker thread, the pipeline cache is internally synchronized so all builds can share it
+template<typename Build>
+static void buildPipeline(VkPipeline* pipeline, Build build) {
+	g.pipelineBuilds.emplace_back([=]() {
+		*pipeline = build();
+		uint64_t end = GetProfileTime();
+		uint64_t latest = g.pipelinesEnd.load();
+		while(latest < end && !g.pipelinesEnd.compare_exchange_weak(latest, end)) {
+		}
+	});
+}
+
+static void waitForPipelines() {
+	if(g.pipelineBuilds.empty()) {
+		return;
+	}
+	uint64_t begin = GetProfileTime();
+	for(std::thread& build : g.pipelineBuilds) {
+		build.join();
+	}
+	g.pipelineBuilds.clear();
+	uint64_t end = GetProfileTime();
+	ProfileRecord("pipeline wait", begin, end);
+	ProfileRecord("pipeline builds", g.pipelinesBegin, g.pipelinesEnd.load());
+	g.startup.pipelineWait = (end - begin) / 1e6f;
+	g.startup.pipelines = (g.pipelinesEnd.load() - g.pipelinesBegin) / 1e6f;
+}
+
+// the large buffers of each feature are only created once the feature is first used
+static void ensureCellBuffers() {
+	if(g.cellBuffer.buffer) {
+		return;
+	}
+	g.cellBuffer = createBuffer(sizeof(glm::uvec2) * gCellCapacity, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.cellVisible = createBuffer(sizeof(glm::uvec2) * gCellCapacity, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.cellCommand = createBuffer(sizeof(CellCommand), VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.cellGridBuffer = createBuffer(sizeof(CellGrid), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.cellGridDirty = true;
+}
+
+// the tiles and shades are sized from the grid itself, ray marching has no cap on its cells
+static void ensureVoxelGridBuffers(glm::ivec3 dims) {
+	glm::ivec3 brickDims = (dims + gVoxelBrick - 1) / gVoxelBrick;
+	VkDeviceSize tileBytes = sizeof(uint32_t) * 2 * brickDims.x * brickDims.y * brickDims.z;
+	VkDeviceSize shadeBytes = sizeof(Color) * gPaletteSize + dims.x * dims.y * dims.z;
+
+	// a frame in flight may still read the smaller buffers, so they are replaced, a grid that outgrew them is uploaded again in full anyway
+	if(g.voxelTileBuffer.size < tileBytes) {
+		if(g.voxelTileBuffer.buffer) {
+			g.perFrame[g.idx % gFramesInFlight].garbage.push_back(g.voxelTileBuffer);
+		}
+		g.voxelTileBuffer = createBuffer(tileBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+	if(g.voxelShadeBuffer.size < shadeBytes) {
+		if(g.voxelShadeBuffer.buffer) {
+			g.perFrame[g.idx % gFramesInFlight].garbage.push_back(g.voxelShadeBuffer);
+		}
+		g.voxelShadeBuffer = createBuffer(shadeBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	}
+}
+
+// what the rasterizer expands the grid into, only created once a grid is rasterized
+static void ensureVoxelBuffers() {
+	if(g.voxelBitBuffer.buffer) {
+		return;
+	}
+	g.voxelBitBuffer = createBuffer(sizeof(uint32_t) * gMaxVoxelWords, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.voxelLodBuffer = createBuffer(sizeof(uint8_t) * gMaxLodCubes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.voxelCubes = createBuffer((sizeof(Cube) + sizeof(uint32_t) * 6) * (gMaxCells + gMaxLodCubes), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.voxelCommand = createBuffer(sizeof(VoxelCommand), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.voxelBricks = createBuffer(sizeof(Brick) * gMaxBricks, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.brickDraws = createBuffer(sizeof(BrickDraws) + sizeof(VkDrawIndexedIndirectCommand) * 2 * gMaxBricks, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	g.voxelBricksStale = true;
+}
+
+static void ensureDensityBuffer() {
+	if(g.densityBuffer.buffer) {
+		return;
+	}
+	g.densityBuffer = createBuffer(sizeof(DensityHeader) + gMaxDensitySquares, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
 static void createSwapchain() {
-	bool msaa = g.windowFlags & FLAG_MSAA_4X_HINT;
+	VkSurfaceCapabilitiesKHR caps;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(g.pDev, g.surf, &caps);
 
 	VkSwapchainKHR oldSwapchain = g.swap;
 	VkSwapchainCreateInfoKHR ci = {};
@@ -217,7 +1030,7 @@ static void createSwapchain() {
 	ci.imageColorSpace = g.surfformat.colorSpace;
 	ci.imageExtent = { static_cast<uint32_t>(g.width), static_cast<uint32_t>(g.height) };
 	ci.imageArrayLayers = 1;
-	ci.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	ci.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | (caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT);   // copied from for captures
 	ci.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
 	ci.queueFamilyIndexCount = 1;
 	ci.pQueueFamilyIndices = &g.fam;
@@ -227,6 +1040,7 @@ static void createSwapchain() {
 	ci.clipped = true;
 	ci.oldSwapchain = oldSwapchain;
 	vkCreateSwapchainKHR(g.lDev, &ci, nullptr, &g.swap);
+	g.swapCopyable = caps.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 	vkDestroySwapchainKHR(g.lDev, oldSwapchain, nullptr);
 
 	uint32_t numSwapchainImages;
@@ -245,11 +1059,125 @@ static void createSwapchain() {
 		vkCreateImageView(g.lDev, &ci, nullptr, &cur);
 		g.views.push_back(cur);
 	}
+}
 
+// everything sized by the framebuffer besides the swapchain images, and in their place the offscreen image when headless
+static void createRenderTargets() {
+	bool msaa = g.windowFlags & FLAG_MSAA_4X_HINT;
+
+	if(g.headless) {
+		g.offscreen = createImage(g.width, g.height, g.surfformat.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false);
+	}
 	if(msaa) {
 		g.msaa = createImage(g.width, g.height, g.surfformat.format, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true);
 	}
-	g.ds = createImage(g.width, g.height, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, msaa);
+	g.ds = createImage(g.width, g.height, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (msaa ? 0 : VK_IMAGE_USAGE_TRANSFER_SRC_BIT), msaa);
+	if(msaa) {
+		g.depthResolve = createImage(g.width, g.height, VK_FORMAT_D32_SFLOAT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false);
+	}
+
+	// halve until 1x1, a level with an odd size is rounded down and its last texel covers the remainder
+	g.hiz = {};
+	int32_t width = g.width;
+	int32_t height = g.height;
+	uint32_t texels = 0;
+	while(g.hiz.count < gMaxHizLevels) {
+		g.hiz.levels[g.hiz.count++] = { texels, width, height };
+		texels += width * height;
+		if(width == 1 && height == 1) {
+			break;
+		}
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	g.hizBuffer = createBuffer(sizeof(HizHeader) + sizeof(float) * texels, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
+static void destroyRenderTargets() {
+	destroyImage(g.offscreen);
+	destroyImage(g.msaa);
+	destroyImage(g.ds);
+	destroyImage(g.depthResolve);
+	destroyBuffer(g.hizBuffer);
+}
+
+// the image and view this frame renders to
+static VkImage colorTarget() {
+	return g.headless ? g.offscreen.image : g.images[g.img];
+}
+
+static VkImageView colorTargetView() {
+	return g.headless ? g.offscreen.view : g.views[g.img];
+}
+
+// the color target can be copied out and its texels written as 8 bit RGB
+static bool canCapture() {
+	VkFormat format = g.surfformat.format;
+	bool rgba8 = format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_UNORM || format == VK_FORMAT_B8G8R8A8_SRGB;
+	return rgba8 && (g.headless || g.swapCopyable);
+}
+
+// copies the color target, already in TRANSFER_SRC_OPTIMAL, into the next slot of the capture ring
+static void recordCapture(const std::string& fileName) {
+	auto& slot = g.captureSlots[g.captureHead++ % gCaptureSlots];
+
+	// a slot comes around again gCaptureSlots captures later, long after its copy landed, so only its encoding can still be running
+	if(slot.state.load(std::memory_order_acquire) != CAPTURE_FREE) {
+		PROFILE_ZONE("capture stall");
+		g.captureStalls++;
+		while(slot.state.load(std::memory_order_acquire) != CAPTURE_FREE) {
+			std::this_thread::yield();
+		}
+	}
+
+	VkDeviceSize size = static_cast<VkDeviceSize>(g.width) * g.height * 4;
+	if(slot.buffer.size < size) {
+		destroyBuffer(slot.buffer);
+		slot.buffer = createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readbackMemory());
+	}
+
+	VkBufferImageCopy region = {};
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { static_cast<uint32_t>(g.width), static_cast<uint32_t>(g.height), 1 };
+	vkCmdCopyImageToBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, colorTarget(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer.buffer, 1, &region);
+
+	slot.frame = g.idx;
+	slot.width = g.width;
+	slot.height = g.height;
+	slot.bgra = g.surfformat.format == VK_FORMAT_B8G8R8A8_UNORM || g.surfformat.format == VK_FORMAT_B8G8R8A8_SRGB;
+	slot.fileName = fileName;
+	slot.state.store(CAPTURE_COPYING, std::memory_order_relaxed);
+	g.captured++;
+}
+
+// hands every slot copied at least gFramesInFlight frames before idx, whose fence has been waited on, to the encoder pool
+static void encodeCaptures(uint64_t idx) {
+	for(auto& slot : g.captureSlots) {
+		if(slot.state.load(std::memory_order_relaxed) != CAPTURE_COPYING || slot.frame + gFramesInFlight > idx) {
+			continue;
+		}
+		slot.state.store(CAPTURE_ENCODING, std::memory_order_relaxed);
+
+		auto* job = &slot;
+		EncodeAsync([job]() {
+			uint64_t begin = GetProfileTime();
+			const unsigned char* pixels = static_cast<const unsigned char*>(job->buffer.hostPtr);
+			size_t length = job->fileName.size();
+			bool png = length >= 4 && job->fileName.compare(length - 4, 4, ".png") == 0;
+			bool written = png ? WritePNG(job->fileName.c_str(), pixels, job->width, job->height, job->bgra) : WritePPM(job->fileName.c_str(), pixels, job->width, job->height, job->bgra);
+			uint64_t end = GetProfileTime();
+			ProfileRecord("capture encode", begin, end);
+
+			if(written) {
+				g.captureWritten++;
+			}
+			else {
+				g.captureFailed++;
+			}
+			g.captureEncodeTime += end - begin;
+			job->state.store(CAPTURE_FREE, std::memory_order_release);
+		});
+	}
 }
 
 static void recreateSwapchain() {
@@ -266,21 +1194,36 @@ static void recreateSwapchain() {
 	}
 	g.views.resize(0);
 
-	destroyImage(g.msaa);
-	destroyImage(g.ds);
+	destroyRenderTargets();
 
 	createSwapchain();
+	createRenderTargets();
 }
 
 void InitWindow(int width, int height, const char* title) {
-	// glfw
-	{
+	g.initBegin = GetProfileTime();
+	uint64_t phaseBegin = g.initBegin;
+	auto endPhase = [&](const char* name, float& ms) {
+		uint64_t end = GetProfileTime();
+		ProfileRecord(name, phaseBegin, end);
+		ms = (end - phaseBegin) / 1e6f;
+		phaseBegin = end;
+	};
+
+	g.headless = g.windowFlags & FLAG_WINDOW_HEADLESS;
+	g.width = width;
+	g.height = height;
+#if defined(_WIN32)
+	// the default 15.6 ms scheduler tick would leave the frame limiter almost nothing to sleep
+	timeBeginPeriod(1);
+#endif
+
+	// glfw, left uninitialized when headless so nothing needs a display
+	if(!g.headless) {
 		glfwInit();
 		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 		g.win = glfwCreateWindow(width, height, title, nullptr, nullptr);
-		g.width = width;
-		g.height = height;
 
 		glfwSetKeyCallback(g.win, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
 			g.keys[key] = action == GLFW_PRESS;
@@ -296,13 +1239,18 @@ void InitWindow(int width, int height, const char* title) {
 			});
 	}
 
+	endPhase("init window", g.startup.window);
+
 	// VkInstance
 	{
 		volkInitialize();
 
+		// surface extensions only, a headless instance needs none
 		unsigned int glfwExtensionCount = 0;
-		const char** glfwExtensions;
-		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		const char** glfwExtensions = nullptr;
+		if(!g.headless) {
+			glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+		}
 
 		VkApplicationInfo ai = {};
 		ai.apiVersion = VK_API_VERSION_1_3;
@@ -322,6 +1270,22 @@ void InitWindow(int width, int height, const char* title) {
 		uint32_t one = 1;
 		vkEnumeratePhysicalDevices(g.inst, &one, &g.pDev);
 		vkGetPhysicalDeviceMemoryProperties(g.pDev, &g.mProps);
+		g.directUpload = hasDirectUploadMemory();
+
+		VkPhysicalDeviceDepthStencilResolveProperties resolveProps = {};
+		VkPhysicalDeviceProperties2 props = {};
+		props.pNext = &resolveProps;
+		vkGetPhysicalDeviceProperties2(g.pDev, &props);
+		g.timestampPeriod = props.properties.limits.timestampPeriod;
+		g.deviceProps = props.properties;
+
+		// MIN keeps the farthest sample with reverse-Z, so the pyramid stays conservative along MSAA edges
+		g.depthResolveMode = (resolveProps.supportedDepthResolveModes & VK_RESOLVE_MODE_MIN_BIT) ? VK_RESOLVE_MODE_MIN_BIT : VK_RESOLVE_MODE_SAMPLE_ZERO_BIT;
+
+		// the brick draws start each brick's faces at its firstInstance, without that the voxel grid is drawn in one piece
+		VkPhysicalDeviceFeatures2 features = {};
+		vkGetPhysicalDeviceFeatures2(g.pDev, &features);
+		g.firstInstanceDraws = features.features.drawIndirectFirstInstance && features.features.multiDrawIndirect;
 	}
 
 	// VkDevice and VkQueue
@@ -335,6 +1299,7 @@ void InitWindow(int width, int height, const char* title) {
 		for(int idx = 0; idx < queueProperties.size(); idx++) {
 			if(queueProperties[idx].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
 				g.fam = idx;
+				g.timestampBits = queueProperties[idx].timestampValidBits;
 				break;
 			}
 		}
@@ -356,13 +1321,19 @@ void InitWindow(int width, int height, const char* title) {
 		f12.scalarBlockLayout = true;
 		f12.bufferDeviceAddress = true;
 		f12.storageBuffer8BitAccess = true;
+		f12.drawIndirectCount = true;
+
+		VkPhysicalDeviceFeatures2 f10 = {};
+		f10.pNext = &f12;
+		f10.features.drawIndirectFirstInstance = g.firstInstanceDraws;
+		f10.features.multiDrawIndirect = g.firstInstanceDraws;
 
 		const char* swapchain = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
 		VkDeviceCreateInfo ci = {};
-		ci.pNext = &f12;
+		ci.pNext = &f10;
 		ci.queueCreateInfoCount = 1;
 		ci.pQueueCreateInfos = &qi;
-		ci.enabledExtensionCount = 1;
+		ci.enabledExtensionCount = g.headless ? 0 : 1;
 		ci.ppEnabledExtensionNames = &swapchain;
 
 
@@ -393,11 +1364,25 @@ void InitWindow(int width, int height, const char* title) {
 			VkFenceCreateInfo fci = {};
 			fci.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 			vkCreateFence(g.lDev, &fci, nullptr, &g.perFrame[i].fence);
+
+			VkQueryPoolCreateInfo qci = {};
+			qci.queryType = VK_QUERY_TYPE_TIMESTAMP;
+			qci.queryCount = TIMESTAMP_COUNT;
+			vkCreateQueryPool(g.lDev, &qci, nullptr, &g.perFrame[i].queryPool);
+
+			g.perFrame[i].view = createBuffer(sizeof(FrameView), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+			g.perFrame[i].march = createBuffer(sizeof(MarchConstants), VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 		}
 	}
 
-	// VkSurface and VkSwapchain
-	{
+	endPhase("init device", g.startup.device);
+
+	// VkSurface and VkSwapchain, or just the render targets when headless
+	if(g.headless) {
+		// byte order of the readback, see GetFramePixels
+		g.surfformat = { VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR };
+	}
+	else {
 		uint32_t count = 0;
 		glfwCreateWindowSurface(g.inst, g.win, nullptr, &g.surf);
 		vkGetPhysicalDeviceSurfaceFormatsKHR(g.pDev, g.surf, &count, nullptr);
@@ -412,21 +1397,13 @@ void InitWindow(int width, int height, const char* title) {
 			}
 		}
 
-		count = 0;
-		vkGetPhysicalDeviceSurfacePresentModesKHR(g.pDev, g.surf, &count, nullptr);
-		std::vector<VkPresentModeKHR> modes(count);
-		vkGetPhysicalDeviceSurfacePresentModesKHR(g.pDev, g.surf, &count, modes.data());
-
-		g.mode = VK_PRESENT_MODE_IMMEDIATE_KHR;
-		for(auto mode : modes) {
-			if(mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-				g.mode == VK_PRESENT_MODE_MAILBOX_KHR;
-				break;
-			}
-		}
+		g.mode = choosePresentMode();
 
 		createSwapchain();
 	}
+	createRenderTargets();
+
+	endPhase("init swapchain", g.startup.swapchain);
 
 	// VkPipelineLayout
 	{
@@ -439,132 +1416,97 @@ void InitWindow(int width, int height, const char* title) {
 		ci.pushConstantRangeCount = 1;
 		ci.pPushConstantRanges = &range;
 		vkCreatePipelineLayout(g.lDev, &ci, nullptr, &g.layout);
+
+		range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+		range.size = std::max({ sizeof(VoxelConstants), sizeof(CullConstants), sizeof(HizConstants), sizeof(BrickConstants) });
+		vkCreatePipelineLayout(g.lDev, &ci, nullptr, &g.computeLayout);
 	}
 
-	// VkPipelines
+	// VkPipelineCache
 	{
-		VkPipelineRenderingCreateInfo ri = {};
-		ri.colorAttachmentCount = 1;
-		ri.pColorAttachmentFormats = &g.surfformat.format;
-		ri.depthAttachmentFormat = VK_FORMAT_D32_SFLOAT;
+		std::vector<char> data = loadPipelineCache();
+		g.startup.pipelineCacheHit = !data.empty();
 
+		VkPipelineCacheCreateInfo ci = {};
+		ci.initialDataSize = data.size();
+		ci.pInitialData = data.data();
+		vkCreatePipelineCache(g.lDev, &ci, nullptr, &g.pipelineCache);
+	}
 
-		VkShaderModuleCreateInfo vtxi = {};
-		vtxi.codeSize = wire_vert_size * sizeof(uint32_t);
-		vtxi.pCode = wire_vert;
-
-		VkShaderModule vtxModule;
-		vkCreateShaderModule(g.lDev, &vtxi, nullptr, &vtxModule);
-
-		VkShaderModuleCreateInfo frgi = {};
-		frgi.codeSize = cube_frag_size * sizeof(uint32_t);
-		frgi.pCode = cube_frag;
-
-		VkShaderModule frgModule;
-		vkCreateShaderModule(g.lDev, &frgi, nullptr, &frgModule);
-
-		VkPipelineShaderStageCreateInfo si[2] = {};
-		si[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-		si[0].module = vtxModule;
-		si[0].pName = "main";
-
-		si[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-		si[1].module = frgModule;
-		si[1].pName = "main";
-
-		VkPipelineVertexInputStateCreateInfo vi = {};
-
-		VkPipelineInputAssemblyStateCreateInfo ii = {};
-		ii.topology = VK_PRIMITIVE_TOPOLOGY_LINE_LIST;
-
-		VkPipelineViewportStateCreateInfo vpi = {};
-		vpi.viewportCount = 1;
-		vpi.scissorCount = 1;
-
-		VkPipelineRasterizationStateCreateInfo rai = {};
-		rai.cullMode = VK_CULL_MODE_BACK_BIT;
-		rai.lineWidth = 1.0f;
-
-		VkPipelineMultisampleStateCreateInfo mi = {};
-		mi.rasterizationSamples = (g.windowFlags & FLAG_MSAA_4X_HINT) ? VK_SAMPLE_COUNT_4_BIT : VK_SAMPLE_COUNT_1_BIT;
-
-		VkPipelineDepthStencilStateCreateInfo di = {};
-		di.depthTestEnable = true;
-		di.depthWriteEnable = true;
-		di.depthCompareOp = VK_COMPARE_OP_GREATER;
-
-		VkPipelineColorBlendAttachmentState as = {};
-		as.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-		as.blendEnable = true;
-		as.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-		as.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-		as.colorBlendOp = VK_BLEND_OP_ADD;
-		as.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-		as.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-		as.alphaBlendOp = VK_BLEND_OP_ADD;
-
-
-		VkPipelineColorBlendStateCreateInfo bi = {};
-		bi.attachmentCount = 1;
-		bi.pAttachments = &as;
-
-		VkDynamicState ds[2] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-
-		VkPipelineDynamicStateCreateInfo dsi = {};
-		dsi.dynamicStateCount = 2;
-		dsi.pDynamicStates = ds;
-
-		VkGraphicsPipelineCreateInfo ci = {};
-		ci.pNext = &ri;
-		ci.stageCount = 2;
-		ci.pStages = si;
-		ci.pVertexInputState = &vi;
-		ci.pInputAssemblyState = &ii;
-		ci.pViewportState = &vpi;
-		ci.pRasterizationState = &rai;
-		ci.pMultisampleState = &mi;
-		ci.pDepthStencilState = &di;
-		ci.pColorBlendState = &bi;
-		ci.pDynamicState = &dsi;
-		ci.layout = g.layout;
-
-		vkCreateGraphicsPipelines(g.lDev, nullptr, 1, &ci, nullptr, &g.wirePipe);
+	// VkPipelines, built in the background while the application finishes its own setup
+	{
+		g.pipelinesBegin = GetProfileTime();
+		g.pipelinesEnd = g.pipelinesBegin;
 
-		vkDestroyShaderModule(g.lDev, vtxModule, nullptr);
+		buildPipeline(&g.wirePipe, []() { return createGraphicsPipeline(wire_vert, wire_vert_size, cube_frag, cube_frag_size, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, true, true); });
+		buildPipeline(&g.solidPipe, []() { return createGraphicsPipeline(solid_vert, solid_vert_size, cube_frag, cube_frag_size, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true, true); });
+		buildPipeline(&g.facePipe, []() { return createGraphicsPipeline(face_vert, face_vert_size, cube_frag, cube_frag_size, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true, true); });
 
-		vtxi.codeSize = solid_vert_size * sizeof(uint32_t);
-		vtxi.pCode = solid_vert;
-		vkCreateShaderModule(g.lDev, &vtxi, nullptr, &vtxModule);
-		si[0].module = vtxModule;
+		// ground density map, translucent and coplanar with whatever it shades, so it leaves depth alone
+		buildPipeline(&g.densityPipe, []() { return createGraphicsPipeline(density_vert, density_vert_size, square_frag, square_frag_size, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true, false); });
 
-		ii.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+		// ray marched voxel grid, a screen covering triangle whose fragments write the depth of the cell they hit
+		buildPipeline(&g.marchPipe, []() { return createGraphicsPipeline(screen_vert, screen_vert_size, march_frag, march_frag_size, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true, true); });
 
-		vkCreateGraphicsPipelines(g.lDev, nullptr, 1, &ci, nullptr, &g.solidPipe);
+		// text overlay, drawn last over everything
+		buildPipeline(&g.textPipe, []() { return createGraphicsPipeline(text_vert, text_vert_size, glyph_frag, glyph_frag_size, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false, false); });
 
-		vkDestroyShaderModule(g.lDev, vtxModule, nullptr);
-		vkDestroyShaderModule(g.lDev, frgModule, nullptr);
+		buildPipeline(&g.voxelPipe, []() { return createComputePipeline(voxel_comp, voxel_comp_size); });
+		buildPipeline(&g.cullPipe, []() { return createComputePipeline(cull_comp, cull_comp_size); });
+		buildPipeline(&g.hizPipe, []() { return createComputePipeline(hiz_comp, hiz_comp_size); });
+		buildPipeline(&g.brickPipe, []() { return createComputePipeline(bricks_comp, bricks_comp_size); });
 	}
 
 	// Buffers
 	{
-		for(int i = 0; i < gFramesInFlight; i++) {
-			g.staging[i] = createBuffer(sizeof(Cube) * (50 * 50 * 50 * 2 + 1), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-		}
+		// small and written once, so it stays in host memory rather than going through staging
+		g.indices = createBuffer(sizeof(gIndices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+		memcpy(g.indices.hostPtr, gIndices, sizeof(gIndices));
 
-		g.cubes = createBuffer(sizeof(Cube) * (50 * 50 * 50 * 2 + 1), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		// the immediate cube buffer and the cell, voxel and density buffers are created on first use (see ensureCellBuffers)
 	}
+
+	g.startup.init = (GetProfileTime() - g.initBegin) / 1e6f;
+	ProfileRecord("InitWindow", g.initBegin, GetProfileTime());
 }
 
 bool WindowShouldClose(void) {
-	return glfwWindowShouldClose(g.win);
+	return !g.headless && glfwWindowShouldClose(g.win);
 }
 
 void CloseWindow(void) {
+	waitForPipelines();
 	vkDeviceWaitIdle(g.lDev);
 
+	// every copy has landed after the idle wait, write what is left before the ring goes away
+	encodeCaptures(g.idx + gFramesInFlight);
+	EncodeShutdown();
+	for(auto& slot : g.captureSlots) {
+		destroyBuffer(slot.buffer);
+	}
+
+	destroyBuffer(g.brickDraws);
+	destroyBuffer(g.voxelBricks);
+	destroyBuffer(g.voxelCommand);
+	destroyBuffer(g.voxelCubes);
+	destroyBuffer(g.voxelTileBuffer);
+	destroyBuffer(g.voxelLodBuffer);
+	destroyBuffer(g.voxelShadeBuffer);
+	destroyBuffer(g.densityBuffer);
+	destroyBuffer(g.voxelBitBuffer);
+	destroyBuffer(g.cellGridBuffer);
+	destroyBuffer(g.cellCommand);
+	destroyBuffer(g.cellVisible);
+	destroyBuffer(g.cellBuffer);
 	destroyBuffer(g.cubes);
+	destroyBuffer(g.indices);
 	for(int i = 0; i < gFramesInFlight; i++) {
-		destroyBuffer(g.staging[i]);
+		for(Buffer buffer : g.perFrame[i].staging) {
+			destroyBuffer(buffer);
+		}
+		for(Buffer buffer : g.perFrame[i].garbage) {
+			destroyBuffer(buffer);
+		}
 	}
 
 	for(VkImageView view : g.views) {
@@ -572,28 +1514,72 @@ void CloseWindow(void) {
 	}
 	g.views.resize(0);
 
-	destroyImage(g.msaa);
-	destroyImage(g.ds);
+	destroyRenderTargets();
 
 	for(int i = 0; i < gFramesInFlight; i++) {
 		vkDestroyCommandPool(g.lDev, g.perFrame[i].cmdPool, nullptr);
 		vkDestroySemaphore(g.lDev, g.perFrame[i].acquireSem, nullptr);
 		vkDestroySemaphore(g.lDev, g.perFrame[i].presentSem, nullptr);
 		vkDestroyFence(g.lDev, g.perFrame[i].fence, nullptr);
+		vkDestroyQueryPool(g.lDev, g.perFrame[i].queryPool, nullptr);
+		destroyBuffer(g.perFrame[i].view);
+		destroyBuffer(g.perFrame[i].march);
+		destroyBuffer(g.perFrame[i].readback);
 	}
 
+	vkDestroyPipeline(g.lDev, g.marchPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.brickPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.hizPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.cullPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.voxelPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.densityPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.textPipe, nullptr);
+	vkDestroyPipeline(g.lDev, g.facePipe, nullptr);
 	vkDestroyPipeline(g.lDev, g.solidPipe, nullptr);
 	vkDestroyPipeline(g.lDev, g.wirePipe, nullptr);
+
+	savePipelineCache();
+	vkDestroyPipelineCache(g.lDev, g.pipelineCache, nullptr);
+	vkDestroyPipelineLayout(g.lDev, g.computeLayout, nullptr);
 	vkDestroyPipelineLayout(g.lDev, g.layout, nullptr);
 
-	vkDestroySwapchainKHR(g.lDev, g.swap, nullptr);
+	// a headless device and instance are created without the swapchain and surface extensions, so those entry points are NULL
+	if(!g.headless) {
+		vkDestroySwapchainKHR(g.lDev, g.swap, nullptr);
+	}
 	vkDestroyDevice(g.lDev, nullptr);
 
-	vkDestroySurfaceKHR(g.inst, g.surf, nullptr);
+	if(!g.headless) {
+		vkDestroySurfaceKHR(g.inst, g.surf, nullptr);
+	}
 	vkDestroyInstance(g.inst, nullptr);
 
-	glfwDestroyWindow(g.win);
-	glfwTerminate();
+	if(!g.headless) {
+		glfwDestroyWindow(g.win);
+		glfwTerminate();
+	}
+#if defined(_WIN32)
+	timeEndPeriod(1);
+#endif
+}
+
+// only FLAG_VSYNC_HINT can change after InitWindow, it takes effect with a new swapchain (never, when headless)
+void SetWindowState(unsigned int flags) {
+	unsigned int before = g.windowFlags;
+	g.windowFlags |= flags & FLAG_VSYNC_HINT;
+	if(g.windowFlags != before && !g.headless) {
+		g.mode = choosePresentMode();
+		recreateSwapchain();
+	}
+}
+
+void ClearWindowState(unsigned int flags) {
+	unsigned int before = g.windowFlags;
+	g.windowFlags &= ~(flags & FLAG_VSYNC_HINT);
+	if(g.windowFlags != before && !g.headless) {
+		g.mode = choosePresentMode();
+		recreateSwapchain();
+	}
 }
 
 bool IsKeyPressed(int key) {
@@ -620,26 +1606,66 @@ Matrix GetCameraMatrix(Camera camera) {
 	return glm::lookAt(camera.position, camera.target, camera.up);
 }
 
+Matrix GetCameraProjectionMatrix(Camera camera) {
+	return perspective(glm::radians(camera.fovy), static_cast<float>(g.width) / g.height, 0.01f);
+}
+
 void ClearBackground(Color color) {
 	glm::vec4 fColor = glm::vec4(color) / glm::vec4(255.0f);
 	g.col = { fColor.r, fColor.g, fColor.b, fColor.a };
 }
 
+// the slot's upload blocks are reclaimed here rather than in EndDrawing, draw calls write into them while the frame is built
 void BeginDrawing(void) {
+	{
+		PROFILE_ZONE("fence wait");
+		vkWaitForFences(g.lDev, 1, &g.perFrame[g.idx % gFramesInFlight].fence, true, std::numeric_limits<uint64_t>::max());
+	}
 
+	// everything this slot uploaded or replaced last time is done with
+	g.perFrame[g.idx % gFramesInFlight].stagingBlock = 0;
+	g.perFrame[g.idx % gFramesInFlight].stagingHead = 0;
+	for(Buffer buffer : g.perFrame[g.idx % gFramesInFlight].garbage) {
+		destroyBuffer(buffer);
+	}
+	g.perFrame[g.idx % gFramesInFlight].garbage.clear();
+
+	encodeCaptures(g.idx);
 }
 
 void EndDrawing(void) {
-	vkWaitForFences(g.lDev, 1, &g.perFrame[g.idx % gFramesInFlight].fence, true, std::numeric_limits<uint64_t>::max());
+	PROFILE_ZONE("EndDrawing");
+	waitForPipelines();
+
+	// the fence covers this slot's last submission, so its timestamps are ready and reading them never stalls
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		uint64_t ts[TIMESTAMP_COUNT];
+		if(vkGetQueryPoolResults(g.lDev, g.perFrame[g.idx % gFramesInFlight].queryPool, 0, TIMESTAMP_COUNT, sizeof(ts), ts, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+			uint64_t mask = g.timestampBits >= 64 ? ~0ull : (1ull << g.timestampBits) - 1;
+			auto ms = [&](int from, int to) { return static_cast<float>(((ts[to] - ts[from]) & mask) * g.timestampPeriod * 1e-6); };
+			g.gpuTimings.upload = ms(TIMESTAMP_BEGIN, TIMESTAMP_UPLOAD);
+			g.gpuTimings.occlusion = ms(TIMESTAMP_UPLOAD, TIMESTAMP_OCCLUSION);
+			g.gpuTimings.wires = ms(TIMESTAMP_OCCLUSION, TIMESTAMP_WIRES);
+			g.gpuTimings.solids = ms(TIMESTAMP_WIRES, TIMESTAMP_SOLIDS);
+			g.gpuTimings.hud = ms(TIMESTAMP_SOLIDS, TIMESTAMP_HUD);
+			g.gpuTimings.total = ms(TIMESTAMP_BEGIN, TIMESTAMP_END);
+		}
+	}
 
-	VkResult result = VK_ERROR_OUT_OF_DATE_KHR;
-	while(result == VK_ERROR_OUT_OF_DATE_KHR) {
-		result = vkAcquireNextImageKHR(g.lDev, g.swap, std::numeric_limits<uint64_t>::max(), g.perFrame[g.idx % gFramesInFlight].acquireSem, nullptr, &g.img);
-		if(result == VK_ERROR_OUT_OF_DATE_KHR) {
-			recreateSwapchain();
+	// headless frames always render to the one offscreen image
+	if(!g.headless) {
+		PROFILE_ZONE("acquire");
+		VkResult result = VK_ERROR_OUT_OF_DATE_KHR;
+		while(result == VK_ERROR_OUT_OF_DATE_KHR) {
+			result = vkAcquireNextImageKHR(g.lDev, g.swap, std::numeric_limits<uint64_t>::max(), g.perFrame[g.idx % gFramesInFlight].acquireSem, nullptr, &g.img);
+			if(result == VK_ERROR_OUT_OF_DATE_KHR) {
+				recreateSwapchain();
+			}
 		}
 	}
 
+	uint64_t recordBegin = GetProfileTime();
+
 	vkResetFences(g.lDev, 1, &g.perFrame[g.idx % gFramesInFlight].fence);
 	vkResetCommandPool(g.lDev, g.perFrame[g.idx % gFramesInFlight].cmdPool, 0);
 
@@ -647,10 +1673,16 @@ void EndDrawing(void) {
 	bi.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	vkBeginCommandBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &bi);
 
+	g.perFrame[g.idx % gFramesInFlight].timed = g.timestampBits != 0;
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdResetQueryPool(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.perFrame[g.idx % gFramesInFlight].queryPool, 0, TIMESTAMP_COUNT);
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_BEGIN);
+	}
+
 	VkMemoryBarrier2 mb = {};
-	mb.srcStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+	mb.srcStageMask = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
 	mb.srcAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
-	mb.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+	mb.dstStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
 	mb.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
 
 	VkDependencyInfo di = {};
@@ -659,13 +1691,266 @@ void EndDrawing(void) {
 
 	vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &di);
 
-	memcpy(reinterpret_cast<char*>(g.staging[g.idx % gFramesInFlight].hostPtr), g.wires.data(), g.wires.size() * sizeof(Cube));
-	memcpy(reinterpret_cast<char*>(g.staging[g.idx % gFramesInFlight].hostPtr) + g.wires.size() * sizeof(Cube), g.solids.data(), g.solids.size() * sizeof(Cube));
+	// wires, then solids, then glyphs
+	const uint32_t wireCount = g.wires.count;
+	const uint32_t solidCount = g.solids.count;
+	VkDeviceAddress glyphPtr = 0;
+
+	if(g.directUpload) {
+		// the cubes are already where the shaders read them, the glyphs only need a range of their own
+		if(!g.glyphs.empty()) {
+			StagingRange range = stagingAlloc(g.glyphs.size() * sizeof(Glyph));
+			memcpy(range.hostPtr, g.glyphs.data(), g.glyphs.size() * sizeof(Glyph));
+			glyphPtr = range.devicePtr;
+		}
+	}
+	else {
+		const VkDeviceSize glyphOffset = (wireCount + solidCount) * sizeof(Cube);
+		const VkDeviceSize cubeBytes = glyphOffset + g.glyphs.size() * sizeof(Glyph);
+
+		// the other frame in flight may still read the old buffer, so it lives until this slot comes around again
+		if(cubeBytes > g.cubes.size) {
+			g.perFrame[g.idx % gFramesInFlight].garbage.push_back(g.cubes);
+			g.cubes = createBuffer(std::max(cubeBytes, g.cubes.size * 2), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		}
 
-	VkBufferCopy bc = {};
-	bc.size = (g.wires.size() + g.solids.size()) * sizeof(Cube);
+		// the cubes are already in the upload blocks, only the glyphs still need staging
+		copyCubes(g.wires, g.cubes.buffer, 0);
+		copyCubes(g.solids, g.cubes.buffer, wireCount * sizeof(Cube));
+		if(!g.glyphs.empty()) {
+			stagedUpload(g.cubes.buffer, glyphOffset, g.glyphs.data(), g.glyphs.size() * sizeof(Glyph));
+		}
+		glyphPtr = g.cubes.devicePtr + glyphOffset;
+	}
 
-	vkCmdCopyBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.staging[g.idx % gFramesInFlight].buffer, g.cubes.buffer, 1, &bc);
+	// the other frame in flight may still read the full buffers, so they are replaced and every live slot goes to the new one
+	if(g.cells.size() > g.cellBuffer.size / sizeof(glm::uvec2)) {
+		VkDeviceSize bytes = std::max<VkDeviceSize>(g.cells.size() * sizeof(glm::uvec2), g.cellBuffer.size * 2);
+		g.perFrame[g.idx % gFramesInFlight].garbage.push_back(g.cellBuffer);
+		g.perFrame[g.idx % gFramesInFlight].garbage.push_back(g.cellVisible);
+		g.cellBuffer = createBuffer(bytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		g.cellVisible = createBuffer(bytes, VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+		g.dirtyCells.resize(g.cells.size());
+		for(uint32_t slot = 0; slot < g.cells.size(); slot++) {
+			g.dirtyCells[slot] = slot;
+		}
+	}
+
+	// only slots touched since the last frame are uploaded, nearby dirty slots are coalesced into one region
+	if(!g.dirtyCells.empty()) {
+		PROFILE_ZONE("cell upload");
+		std::sort(g.dirtyCells.begin(), g.dirtyCells.end());
+
+		std::vector<VkBufferCopy> regions;
+		VkDeviceSize regionBytes = 0;
+		for(size_t i = 0; i < g.dirtyCells.size();) {
+			uint32_t first = g.dirtyCells[i];
+			uint32_t last = first;
+			for(i++; i < g.dirtyCells.size() && g.dirtyCells[i] <= last + gDirtyGap; i++) {
+				last = g.dirtyCells[i];
+			}
+			if(first >= g.cells.size()) {
+				continue;
+			}
+			last = std::min<uint32_t>(last, g.cells.size() - 1);
+
+			VkBufferCopy region = {};
+			region.srcOffset = regionBytes;
+			region.dstOffset = first * sizeof(glm::uvec2);
+			region.size = (last - first + 1) * sizeof(glm::uvec2);
+			regionBytes += region.size;
+			regions.push_back(region);
+		}
+		g.dirtyCells.clear();
+
+		// one range for all regions so they share a source buffer and a single copy command
+		if(!regions.empty()) {
+			StagingRange range = stagingAlloc(regionBytes);
+			for(VkBufferCopy& region : regions) {
+				memcpy(range.hostPtr + region.srcOffset, reinterpret_cast<const char*>(g.cells.data()) + region.dstOffset, region.size);
+				region.srcOffset += range.offset;
+			}
+			vkCmdCopyBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, range.buffer, g.cellBuffer.buffer, regions.size(), regions.data());
+		}
+	}
+
+	if(g.drawDensity && g.densityDirty) {
+		stagedUpload(g.densityBuffer.buffer, 0, g.densityMap.data(), g.densityMap.size());
+		g.densityDirty = false;
+	}
+
+	// the brick tiles are patched brick by brick like the dirty cell instances, whether or not they are marched this frame
+	if(g.drawVoxels && (g.voxelTilesStale || !g.dirtyTiles.empty())) {
+		PROFILE_ZONE("tile upload");
+		if(g.voxelTilesStale) {
+			stagedUpload(g.voxelTileBuffer.buffer, 0, g.voxelTiles.data(), g.voxelTiles.size() * sizeof(uint32_t));
+			g.voxelTilesStale = false;
+		}
+		else {
+			std::sort(g.dirtyTiles.begin(), g.dirtyTiles.end());
+
+			std::vector<VkBufferCopy> regions;
+			VkDeviceSize regionBytes = 0;
+			for(size_t i = 0; i < g.dirtyTiles.size();) {
+				uint32_t first = g.dirtyTiles[i];
+				uint32_t last = first;
+				for(i++; i < g.dirtyTiles.size() && g.dirtyTiles[i] <= last + gDirtyGap; i++) {
+					last = g.dirtyTiles[i];
+				}
+
+				VkBufferCopy region = {};
+				region.srcOffset = regionBytes;
+				region.dstOffset = first * 2 * sizeof(uint32_t);
+				region.size = (last - first + 1) * 2 * sizeof(uint32_t);
+				regionBytes += region.size;
+				regions.push_back(region);
+			}
+
+			StagingRange range = stagingAlloc(regionBytes);
+			for(VkBufferCopy& region : regions) {
+				memcpy(range.hostPtr + region.srcOffset, reinterpret_cast<const char*>(g.voxelTiles.data()) + region.dstOffset, region.size);
+				region.srcOffset += range.offset;
+			}
+			vkCmdCopyBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, range.buffer, g.voxelTileBuffer.buffer, regions.size(), regions.data());
+		}
+		g.dirtyTiles.clear();
+	}
+
+	// both renderers color cells from the shades
+	if(g.drawVoxels && g.voxelShadesDirty) {
+		stagedUpload(g.voxelShadeBuffer.buffer, 0, g.voxelShades.data(), g.voxelShades.size());
+		g.voxelShadesDirty = false;
+	}
+
+	// the occupancy mask is uploaded and re-expanded only when it changed, otherwise last frame's cubes are drawn again
+	bool rasterVoxels = g.drawVoxels && !g.rayMarching && g.voxelBitBuffer.buffer && g.voxel.dims.x * g.voxel.dims.y * g.voxel.dims.z <= gMaxCells;
+	bool expandVoxels = rasterVoxels && g.voxelDirty;
+	if(expandVoxels) {
+		stagedUpload(g.voxelBitBuffer.buffer, 0, g.voxelBits.data(), g.voxelBits.size() * sizeof(uint32_t));
+		stagedUpload(g.voxelLodBuffer.buffer, 0, g.voxelLod.data(), g.voxelLod.size());
+
+		VoxelCommand cmd = { { 6, 0, INDEX_FACE, 0, 0 }, 0, 0, 0 };
+		vkCmdUpdateBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.voxelCommand.buffer, 0, sizeof(cmd), &cmd);
+	}
+
+	if(g.cellGridDirty && g.cellGridBuffer.buffer) {
+		stagedUpload(g.cellGridBuffer.buffer, 0, &g.cellGrid, sizeof(CellGrid));
+		g.cellGridDirty = false;
+	}
+
+	// the cull pass rebuilds the visible list of the retained cells from scratch every frame, solids and wires share it
+	bool cullCells = (g.drawCells || g.drawCellWires) && g.gpuCulling && !g.cells.empty();
+	if(cullCells) {
+		CellCommand cmd = { { g.cullDisabled ? 36u : 18u, 0, static_cast<uint32_t>(g.cullDisabled ? INDEX_SOLID_ALL : INDEX_SOLID_VISIBLE), 0, 0 }, { 24, 0, INDEX_WIRE, 0, 0 } };
+		vkCmdUpdateBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.cellCommand.buffer, 0, sizeof(cmd), &cmd);
+	}
+
+	// occluded bricks are skipped in two phases, see bricks.comp, without occlusion culling a single phase still picks each brick's level of detail
+	glm::ivec3 brickDims = (g.voxel.dims + gVoxelBrick - 1) / gVoxelBrick;
+	uint32_t brickCount = brickDims.x * brickDims.y * brickDims.z;
+	bool occlude = rasterVoxels && g.firstInstanceDraws && g.occlusionCulling;
+	bool lodOnly = rasterVoxels && g.firstInstanceDraws && g.lod && !occlude;
+	if(occlude) {
+		if(g.voxelBricksStale) {
+			vkCmdFillBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.voxelBricks.buffer, 0, VK_WHOLE_SIZE, 0);
+			g.voxelBricksStale = false;
+		}
+		vkCmdUpdateBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.hizBuffer.buffer, 0, sizeof(HizHeader), &g.hiz);
+	}
+	if(occlude || lodOnly) {
+		BrickDraws draws = { 0, 0, 6, INDEX_FACE };
+		vkCmdUpdateBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.brickDraws.buffer, 0, sizeof(draws), &draws);
+	}
+
+	if(expandVoxels || cullCells || occlude || lodOnly) {
+		VkMemoryBarrier2 cb = {};
+		cb.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		cb.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		cb.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		cb.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		VkDependencyInfo cdi = {};
+		cdi.memoryBarrierCount = 1;
+		cdi.pMemoryBarriers = &cb;
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &cdi);
+	}
+
+	if(expandVoxels) {
+		g.voxel.bits = g.voxelBitBuffer.devicePtr;
+		g.voxel.cubes = g.voxelCubes.devicePtr;
+		g.voxel.cmd = g.voxelCommand.devicePtr;
+		g.voxel.faces = sizeof(Cube) * (gMaxCells + gMaxLodCubes) / sizeof(uint32_t);
+		g.voxel.bricks = g.voxelBricks.devicePtr;
+		g.voxel.shades = g.voxelShadeBuffer.devicePtr;
+		g.voxel.lod = g.voxelLodBuffer.devicePtr;
+		g.voxel.lodCubes = gMaxCells;
+		g.voxel.lodFaces = g.voxel.faces + 6 * gMaxCells;
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, g.voxelPipe);
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(VoxelConstants), &g.voxel);
+		vkCmdDispatch(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, brickDims.x, brickDims.y, brickDims.z);
+		g.voxelDirty = false;
+	}
+
+	BrickConstants brickPcs = {};
+	brickPcs.bricks = g.voxelBricks.devicePtr;
+	brickPcs.hiz = g.hizBuffer.devicePtr;
+	brickPcs.draws = g.brickDraws.devicePtr;
+	brickPcs.view = g.perFrame[g.idx % gFramesInFlight].view.devicePtr;
+	brickPcs.dims = g.voxel.dims;
+	brickPcs.size = g.voxel.size;
+	brickPcs.pos = g.voxel.pos;
+
+	if((occlude || lodOnly) && expandVoxels) {
+		VkMemoryBarrier2 eb = {};
+		eb.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		eb.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		eb.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		eb.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		VkDependencyInfo edi = {};
+		edi.memoryBarrierCount = 1;
+		edi.pMemoryBarriers = &eb;
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &edi);
+	}
+
+	if(occlude || lodOnly) {
+		brickPcs.phase = occlude ? 0 : 2;
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, g.brickPipe);
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BrickConstants), &brickPcs);
+		vkCmdDispatch(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, (brickCount + 63) / 64, 1, 1);
+	}
+
+	if(cullCells) {
+		CullConstants cull = {};
+		cull.src = g.cellBuffer.devicePtr;
+		cull.dst = g.cellVisible.devicePtr;
+		cull.cmd = g.cellCommand.devicePtr;
+		cull.count = static_cast<uint32_t>(g.cells.size());
+		cull.view = g.perFrame[g.idx % gFramesInFlight].view.devicePtr;
+		cull.grid = g.cellGridBuffer.devicePtr;
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, g.cullPipe);
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &cull);
+		vkCmdDispatch(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, (cull.count + 63) / 64, 1, 1);
+
+		// the shader only counts the solids, the wires draw the same survivors
+		VkMemoryBarrier2 cb = {};
+		cb.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		cb.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		cb.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		cb.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+		VkDependencyInfo cdi = {};
+		cdi.memoryBarrierCount = 1;
+		cdi.pMemoryBarriers = &cb;
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &cdi);
+
+		VkBufferCopy count = { offsetof(CellCommand, solid.instanceCount), offsetof(CellCommand, wire.instanceCount), sizeof(uint32_t) };
+		vkCmdCopyBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.cellCommand.buffer, g.cellCommand.buffer, 1, &count);
+	}
+
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_UPLOAD);
+	}
 
 	std::swap(mb.srcStageMask, mb.dstStageMask);
 	std::swap(mb.srcAccessMask, mb.dstAccessMask);
@@ -675,12 +1960,13 @@ void EndDrawing(void) {
 	VkImageSubresourceRange depthRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
 
 	std::vector<VkImageMemoryBarrier2> barriers(msaa ? 3 : 2);
-	barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+	// the offscreen image is shared by every frame in flight, so the previous frame's readback copy has to finish first
+	barriers[0].srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | (g.headless ? VK_PIPELINE_STAGE_2_COPY_BIT : 0);
 	barriers[0].dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
 	barriers[0].dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
 	barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 	barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-	barriers[0].image = g.images[g.img];
+	barriers[0].image = colorTarget();
 	barriers[0].subresourceRange = colorRange;
 
 	barriers[1].srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
@@ -703,6 +1989,19 @@ void EndDrawing(void) {
 		barriers[2].subresourceRange = colorRange;
 	}
 
+	// last read by the pyramid copy, written by the depth resolve of the first pass
+	if(msaa && occlude) {
+		VkImageMemoryBarrier2 rb = {};
+		rb.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		rb.dstStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+		rb.dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		rb.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		rb.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+		rb.image = g.depthResolve.image;
+		rb.subresourceRange = depthRange;
+		barriers.push_back(rb);
+	}
+
 	di.imageMemoryBarrierCount = barriers.size();
 	di.pImageMemoryBarriers = barriers.data();
 
@@ -712,12 +2011,13 @@ void EndDrawing(void) {
 	VkRect2D sc = { { 0, 0 }, { static_cast<uint32_t>(g.width), static_cast<uint32_t>(g.height) } };
 	vkCmdSetViewport(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, 0, 1, &vp);
 	vkCmdSetScissor(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, 0, 1, &sc);
+	vkCmdSetCullMode(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.cullDisabled ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
 
 	VkRenderingAttachmentInfo ai1 = {};
-	ai1.imageView = msaa ? g.msaa.view : g.views[g.img];
+	ai1.imageView = msaa ? g.msaa.view : colorTargetView();
 	ai1.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	ai1.resolveMode = msaa ? VK_RESOLVE_MODE_AVERAGE_BIT : VK_RESOLVE_MODE_NONE;
-	ai1.resolveImageView = g.views[g.img];
+	ai1.resolveImageView = colorTargetView();
 	ai1.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	ai1.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
 	ai1.storeOp = msaa ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
@@ -737,28 +2037,277 @@ void EndDrawing(void) {
 	ri.pColorAttachments = &ai1;
 	ri.pDepthAttachment = &ai2;
 
+	// first pass: the bricks visible last frame, their depth becomes the pyramid the rest of the bricks are tested against
+	if(occlude) {
+		VkRenderingAttachmentInfo early1 = ai1;
+		early1.resolveMode = VK_RESOLVE_MODE_NONE;
+		early1.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+
+		VkRenderingAttachmentInfo early2 = ai2;
+		early2.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		if(msaa) {
+			early2.resolveMode = g.depthResolveMode;
+			early2.resolveImageView = g.depthResolve.view;
+			early2.resolveImageLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+		}
+
+		VkRenderingInfo early = ri;
+		early.pColorAttachments = &early1;
+		early.pDepthAttachment = &early2;
+
+		PushConstants voxelPcs = {};
+		voxelPcs.buf = g.voxelCubes.devicePtr;
+		voxelPcs.offs = g.voxel.faces;
+		voxelPcs.view = g.perFrame[g.idx % gFramesInFlight].view.devicePtr;
+
+		vkCmdBeginRendering(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &early);
+		vkCmdBindIndexBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.indices.buffer, 0, VK_INDEX_TYPE_UINT16);
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &voxelPcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.facePipe);
+		vkCmdDrawIndexedIndirectCount(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.brickDraws.buffer, sizeof(BrickDraws), g.brickDraws.buffer, offsetof(BrickDraws, early), brickCount, sizeof(VkDrawIndexedIndirectCommand));
+		vkCmdEndRendering(g.perFrame[g.idx % gFramesInFlight].cmdBuffer);
+
+		Image& depth = msaa ? g.depthResolve : g.ds;
+		VkImageMemoryBarrier2 db = {};
+		db.srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		db.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		db.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		db.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+		db.oldLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+		db.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		db.image = depth.image;
+		db.subresourceRange = depthRange;
+
+		VkDependencyInfo ddi = {};
+		ddi.imageMemoryBarrierCount = 1;
+		ddi.pImageMemoryBarriers = &db;
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &ddi);
+
+		VkBufferImageCopy copy = {};
+		copy.bufferOffset = sizeof(HizHeader);
+		copy.imageSubresource = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 0, 1 };
+		copy.imageExtent = { static_cast<uint32_t>(g.width), static_cast<uint32_t>(g.height), 1 };
+		vkCmdCopyImageToBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, depth.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, g.hizBuffer.buffer, 1, &copy);
+
+		VkMemoryBarrier2 hb = {};
+		hb.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		hb.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		hb.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		hb.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+
+		VkDependencyInfo hdi = {};
+		hdi.memoryBarrierCount = 1;
+		hdi.pMemoryBarriers = &hb;
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &hdi);
+
+		hb.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, g.hizPipe);
+		for(uint32_t level = 1; level < g.hiz.count; level++) {
+			HizConstants hizPcs;
+			hizPcs.src = g.hizBuffer.devicePtr + sizeof(HizHeader) + sizeof(float) * g.hiz.levels[level - 1].offset;
+			hizPcs.dst = g.hizBuffer.devicePtr + sizeof(HizHeader) + sizeof(float) * g.hiz.levels[level].offset;
+			hizPcs.srcSize = { g.hiz.levels[level - 1].width, g.hiz.levels[level - 1].height };
+			hizPcs.dstSize = { g.hiz.levels[level].width, g.hiz.levels[level].height };
+			vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(HizConstants), &hizPcs);
+			vkCmdDispatch(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, (hizPcs.dstSize.x + 7) / 8, (hizPcs.dstSize.y + 7) / 8, 1);
+			vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &hdi);
+		}
+
+		brickPcs.phase = 1;
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, g.brickPipe);
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(BrickConstants), &brickPcs);
+		vkCmdDispatch(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, (brickCount + 63) / 64, 1, 1);
+
+		// the second pass reads the phase 1 commands and continues on top of the first pass' attachments
+		VkMemoryBarrier2 lb[2] = {};
+		lb[0].srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		lb[0].srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		lb[0].dstStageMask = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+		lb[0].dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+		lb[1].srcStageMask = VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		lb[1].srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
+		lb[1].dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+		lb[1].dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+
+		db.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		db.srcAccessMask = 0;
+		db.dstStageMask = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT;
+		db.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+		db.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		db.newLayout = VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+
+		// the resolved copy is not an attachment of the second pass and stays as it is
+		ddi = {};
+		ddi.memoryBarrierCount = 2;
+		ddi.pMemoryBarriers = lb;
+		ddi.imageMemoryBarrierCount = msaa ? 0 : 1;
+		ddi.pImageMemoryBarriers = &db;
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &ddi);
+
+		ai1.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+		ai2.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	}
+
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_OCCLUSION);
+	}
+
 	vkCmdBeginRendering(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &ri);
+	vkCmdBindIndexBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.indices.buffer, 0, VK_INDEX_TYPE_UINT16);
 
-	PushConstants pcs;
+	PushConstants pcs = {};
 	pcs.buf = g.cubes.devicePtr;
-	pcs.offs = g.wires.size();
-	pcs.trans = g.transform;
+	pcs.offs = wireCount;
+	pcs.view = g.perFrame[g.idx % gFramesInFlight].view.devicePtr;
 	vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
 	vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.wirePipe);
-	vkCmdDraw(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.wires.size() * 24, 1, 0, 0);
+	drawCubes(g.wires, pcs, 0, 24, INDEX_WIRE);
+
+	if(g.drawCellWires && !g.cells.empty()) {
+		PushConstants cellPcs = pcs;
+		cellPcs.buf = cullCells ? g.cellVisible.devicePtr : g.cellBuffer.devicePtr;
+		cellPcs.offs = 0;
+		cellPcs.grid = g.cellGridBuffer.devicePtr;
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &cellPcs);
+		if(cullCells) {
+			vkCmdDrawIndexedIndirect(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.cellCommand.buffer, offsetof(CellCommand, wire), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else {
+			vkCmdDrawIndexed(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, 24, g.cells.size(), INDEX_WIRE, 0, 0);
+		}
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+	}
+
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_WIRES);
+	}
 
 	vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.solidPipe);
-	vkCmdDraw(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.solids.size() * 36, 1, 0, 0);
+
+	// with culling on only the faces toward the eye are emitted, the rest would be culled after shading their vertices
+	uint32_t solidIndices = g.cullDisabled ? 36 : 18;
+	uint32_t solidFirst = g.cullDisabled ? INDEX_SOLID_ALL : INDEX_SOLID_VISIBLE;
+
+	// retained cells and the voxel grid go first so translucent immediate solids blend over them
+	if(g.drawVoxels && g.rayMarching) {
+		MarchConstants* march = reinterpret_cast<MarchConstants*>(g.perFrame[g.idx % gFramesInFlight].march.hostPtr);
+		march->tiles = g.voxelTileBuffer.devicePtr;
+		march->shades = g.voxelShadeBuffer.devicePtr;
+		march->view = g.perFrame[g.idx % gFramesInFlight].view.devicePtr;
+		march->dims = g.voxel.dims;
+		march->size = g.voxel.size;
+		march->pos = g.voxel.pos;
+		march->inner = g.voxel.inner;
+		march->outer = g.voxel.outer;
+		march->shaded = g.voxel.shaded;
+
+		PushConstants marchPcs = pcs;
+		marchPcs.buf = g.perFrame[g.idx % gFramesInFlight].march.devicePtr;
+		marchPcs.offs = 0;
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &marchPcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.marchPipe);
+		vkCmdSetCullMode(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_CULL_MODE_NONE);
+		vkCmdDraw(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, 3, 1, 0, 0);
+		vkCmdSetCullMode(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.cullDisabled ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT);
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.solidPipe);
+	}
+	else if(g.drawVoxels) {
+		PushConstants voxelPcs = pcs;
+		voxelPcs.buf = g.voxelCubes.devicePtr;
+		voxelPcs.offs = g.voxel.faces;
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &voxelPcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.facePipe);
+		if(occlude || lodOnly) {
+			VkDeviceSize lateOffset = sizeof(BrickDraws) + sizeof(VkDrawIndexedIndirectCommand) * brickCount;
+			vkCmdDrawIndexedIndirectCount(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.brickDraws.buffer, lateOffset, g.brickDraws.buffer, offsetof(BrickDraws, late), brickCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else {
+			vkCmdDrawIndexedIndirect(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.voxelCommand.buffer, 0, 1, sizeof(VoxelCommand));
+		}
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.solidPipe);
+	}
+
+	if(g.drawCells && !g.cells.empty()) {
+		PushConstants cellPcs = pcs;
+		cellPcs.buf = cullCells ? g.cellVisible.devicePtr : g.cellBuffer.devicePtr;
+		cellPcs.offs = 0;
+		cellPcs.grid = g.cellGridBuffer.devicePtr;
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &cellPcs);
+		if(cullCells) {
+			vkCmdDrawIndexedIndirect(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.cellCommand.buffer, offsetof(CellCommand, solid), 1, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else {
+			vkCmdDrawIndexed(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, solidIndices, g.cells.size(), solidFirst, 0, 0);
+		}
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+	}
+
+	drawCubes(g.solids, pcs, wireCount, solidIndices, solidFirst);
+
+	// the whole density map is one quad seen from either side
+	if(g.drawDensity) {
+		PushConstants densityPcs = pcs;
+		densityPcs.buf = g.densityBuffer.devicePtr;
+		densityPcs.offs = 0;
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &densityPcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.densityPipe);
+		vkCmdSetCullMode(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_CULL_MODE_NONE);
+		vkCmdDraw(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, 6, 1, 0, 0);
+	}
+
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_SOLIDS);
+	}
+
+	// the whole overlay is one instanced draw of glyph quads in pixel space
+	if(!g.glyphs.empty()) {
+		pcs.buf = glyphPtr;
+		pcs.offs = 0;
+		pcs.trans = glm::translate(glm::mat4(1.0f), glm::vec3(-1.0f, -1.0f, 0.0f)) * glm::scale(glm::mat4(1.0f), glm::vec3(2.0f / g.width, 2.0f / g.height, 1.0f));
+		vkCmdPushConstants(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pcs);
+		vkCmdBindPipeline(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, g.textPipe);
+		vkCmdSetCullMode(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_CULL_MODE_NONE);
+		vkCmdDraw(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, 6, g.glyphs.size(), 0, 0);
+	}
+
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_ALL_GRAPHICS_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_HUD);
+	}
 
 	vkCmdEndRendering(g.perFrame[g.idx % gFramesInFlight].cmdBuffer);
 
+	// captures and the headless readback, once asked for, copy the finished frame before it is presented
+	std::vector<std::string> captures;
+	if(!g.screenshot.empty()) {
+		captures.push_back(g.screenshot);
+		g.screenshot.clear();
+	}
+	if(!g.captureFormat.empty()) {
+		char fileName[512];
+		snprintf(fileName, sizeof(fileName), g.captureFormat.c_str(), g.captureFrame++);
+		captures.push_back(fileName);
+	}
+	if(!captures.empty() && !canCapture()) {
+		g.captureFailed += static_cast<int>(captures.size());
+		captures.clear();
+	}
+	g.perFrame[g.idx % gFramesInFlight].readBack = g.headless && g.readFrames;
+	bool copied = g.perFrame[g.idx % gFramesInFlight].readBack || !captures.empty();
+
 	VkImageMemoryBarrier2 ib = {};
 	ib.srcStageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
 	ib.srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT;
 	ib.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 	ib.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-	ib.image = g.images[g.img];
+	ib.image = colorTarget();
 	ib.subresourceRange = colorRange;
+	if(copied) {
+		ib.dstStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		ib.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+		ib.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
 
 	di = {};
 	di.imageMemoryBarrierCount = 1;
@@ -766,8 +2315,53 @@ void EndDrawing(void) {
 
 	vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &di);
 
+	for(const std::string& fileName : captures) {
+		recordCapture(fileName);
+	}
+
+	// in place of presenting, the frame goes to this slot's readback buffer, which the host reads once the fence signals
+	if(g.perFrame[g.idx % gFramesInFlight].readBack) {
+		if(!g.perFrame[g.idx % gFramesInFlight].readback.buffer) {
+			g.perFrame[g.idx % gFramesInFlight].readback = createBuffer(static_cast<uint64_t>(g.width) * g.height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT, readbackMemory());
+		}
+		VkBufferImageCopy region = {};
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageExtent = { static_cast<uint32_t>(g.width), static_cast<uint32_t>(g.height), 1 };
+		vkCmdCopyImageToBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, g.offscreen.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, g.perFrame[g.idx % gFramesInFlight].readback.buffer, 1, &region);
+	}
+
+	if(copied) {
+		VkMemoryBarrier2 hb = {};
+		hb.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		hb.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		hb.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+		hb.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+		// a captured swapchain image still has to reach the presentation layout
+		ib.srcStageMask = VK_PIPELINE_STAGE_2_COPY_BIT;
+		ib.srcAccessMask = VK_ACCESS_2_NONE;
+		ib.dstStageMask = VK_PIPELINE_STAGE_2_NONE;
+		ib.dstAccessMask = VK_ACCESS_2_NONE;
+		ib.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		ib.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+		di = {};
+		di.memoryBarrierCount = 1;
+		di.pMemoryBarriers = &hb;
+		di.imageMemoryBarrierCount = g.headless ? 0 : 1;
+		di.pImageMemoryBarriers = &ib;
+
+		vkCmdPipelineBarrier2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, &di);
+	}
+
+	if(g.perFrame[g.idx % gFramesInFlight].timed) {
+		vkCmdWriteTimestamp2(g.perFrame[g.idx % gFramesInFlight].cmdBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, g.perFrame[g.idx % gFramesInFlight].queryPool, TIMESTAMP_END);
+	}
+
 	vkEndCommandBuffer(g.perFrame[g.idx % gFramesInFlight].cmdBuffer);
 
+	ProfileRecord("record", recordBegin, GetProfileTime());
+
 	VkSemaphoreSubmitInfo ssi1 = {};
 	ssi1.semaphore = g.perFrame[g.idx % gFramesInFlight].acquireSem;
 	ssi1.stageMask = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
@@ -780,14 +2374,26 @@ void EndDrawing(void) {
 	csi.commandBuffer = g.perFrame[g.idx % gFramesInFlight].cmdBuffer;
 
 	VkSubmitInfo2 si = {};
-	si.waitSemaphoreInfoCount = 1;
+	si.waitSemaphoreInfoCount = g.headless ? 0 : 1;
 	si.pWaitSemaphoreInfos = &ssi1;
 	si.commandBufferInfoCount = 1;
 	si.pCommandBufferInfos = &csi;
-	si.signalSemaphoreInfoCount = 1;
+	si.signalSemaphoreInfoCount = g.headless ? 0 : 1;
 	si.pSignalSemaphoreInfos = &ssi2;
 
-	vkQueueSubmit2(g.q, 1, &si, g.perFrame[g.idx % gFramesInFlight].fence);
+	// nothing recorded depends on the camera, so it can still move: poll once more and let the application re-place it
+	if(g.latch) {
+		PROFILE_ZONE("latch");
+		pollInput();
+		setCamera(g.latch(g.camera));
+	}
+	writeView();
+	g.inputLatency[g.frameSamples % gFrameTimeSamples] = static_cast<float>(getTime() - g.inputTime);
+
+	{
+		PROFILE_ZONE("submit");
+		vkQueueSubmit2(g.q, 1, &si, g.perFrame[g.idx % gFramesInFlight].fence);
+	}
 
 	VkPresentInfoKHR pi = {};
 	pi.waitSemaphoreCount = 1;
@@ -796,31 +2402,97 @@ void EndDrawing(void) {
 	pi.pSwapchains = &g.swap;
 	pi.pImageIndices = &g.img;
 
-	if(vkQueuePresentKHR(g.q, &pi) != VK_SUCCESS) {
-		recreateSwapchain();
+	if(!g.headless) {
+		PROFILE_ZONE("present");
+		if(vkQueuePresentKHR(g.q, &pi) != VK_SUCCESS) {
+			recreateSwapchain();
+		}
+	}
+
+	if(g.startup.firstFrame == 0.0f) {
+		g.startup.firstFrame = (GetProfileTime() - g.initBegin) / 1e6f;
 	}
 
-	g.solids.clear();
-	g.wires.clear();
+	resetCubes(g.wires);
+	resetCubes(g.solids);
+	g.glyphs.clear();
+	g.drawCells = false;
+	g.drawCellWires = false;
+	g.drawVoxels = false;
+	g.drawDensity = false;
 
 	g.idx++;
 
-	double time = glfwGetTime();
-	while(time - g.curTime < g.frameTime) {
-		time = glfwGetTime();
-	}
-	
-	g.curTime = time;
+	uint64_t paceBegin = GetProfileTime();
+	waitForDeadline(g.curTime + g.frameTime);
+	double time = getTime();
+	ProfileRecord("frame pace", paceBegin, GetProfileTime());
 
-	g.scroll = 0.0;
-	g.prevMousePos = g.mousePos;
-	memcpy(&g.prevKeys, &g.keys, sizeof(g.keys));
+	g.frameTimes[g.frameSamples++ % gFrameTimeSamples] = static_cast<float>(time - g.curTime);
+	g.curTime = time;
 
-	glfwPollEvents();
+	// with a latch the input of the next frame was already polled before submission
+	if(!g.latch) {
+		pollInput();
+	}
 }
 
 void BeginMode3D(Camera3D camera) {
-	g.transform = perspective(glm::radians(camera.fovy), static_cast<float>(g.width) / g.height, 0.01f) * glm::lookAt(camera.position, camera.target, camera.up);
+	g.camera = camera;
+	setCamera(camera);
+}
+
+void SetCameraLatch(Camera3D (*latch)(Camera3D camera)) {
+	g.latch = latch;
+}
+
+// the oldest slot is the one recorded next, its readback holds the frame submitted gFramesInFlight frames before
+// frames are only copied once pixels have been asked for, so the first calls return nullptr until such a frame is done
+const unsigned char* GetFramePixels(int* width, int* height) {
+	g.readFrames = g.headless;
+	if(!g.perFrame[g.idx % gFramesInFlight].readBack) {
+		return nullptr;
+	}
+	vkWaitForFences(g.lDev, 1, &g.perFrame[g.idx % gFramesInFlight].fence, true, std::numeric_limits<uint64_t>::max());
+	*width = g.width;
+	*height = g.height;
+	return static_cast<const unsigned char*>(g.perFrame[g.idx % gFramesInFlight].readback.hostPtr);
+}
+
+void TakeScreenshot(const char* fileName) {
+	g.screenshot = fileName;
+}
+
+void BeginFrameCapture(const char* fileNameFormat) {
+	g.captureFormat = fileNameFormat;
+	g.captureFrame = 0;
+}
+
+void EndFrameCapture(void) {
+	g.captureFormat.clear();
+}
+
+CaptureStats GetCaptureStats(void) {
+	CaptureStats stats = {};
+	stats.captured = g.captured;
+	stats.written = g.captureWritten;
+	stats.failed = g.captureFailed;
+	for(auto& slot : g.captureSlots) {
+		stats.pending += slot.state.load(std::memory_order_relaxed) != CAPTURE_FREE;
+	}
+	stats.stalls = g.captureStalls;
+	int encoded = stats.written + stats.failed;
+	stats.encodeMs = encoded ? g.captureEncodeTime / 1e6f / encoded : 0.0f;
+	return stats;
+}
+
+float GetInputLatency(void) {
+	uint64_t count = std::min<uint64_t>(g.frameSamples, gFrameTimeSamples);
+	float total = 0.0f;
+	for(uint64_t i = 0; i < count; i++) {
+		total += g.inputLatency[i];
+	}
+	return count ? total * 1000.0f / count : 0.0f;
 }
 
 void EndMode3D(void) {
@@ -828,19 +2500,351 @@ void EndMode3D(void) {
 }
 
 void rlEnableBackfaceCulling(void) {
+	g.cullDisabled = false;
+}
 
+void rlDisableBackfaceCulling(void) {
+	g.cullDisabled = true;
 }
 
 void DrawCube(Vector3 position, float width, float height, float length, Color color) {
-	g.solids.push_back(Cube{ position, glm::vec3(width, height, length), color });
+	pushCube(g.solids, Cube{ position, glm::vec3(width, height, length), color });
 }
 
 void DrawCubeWires(Vector3 position, float width, float height, float length, Color color) {
-	g.wires.push_back(Cube{ position, glm::vec3(width, height, length), color });
+	pushCube(g.wires, Cube{ position, glm::vec3(width, height, length), color });
+}
+
+void SetCellGrid(Vector3 position, float size, const Color* palette) {
+	ensureCellBuffers();
+	CellGrid grid = g.cellGrid;
+	grid.pos = position;
+	grid.size = size;
+	std::copy(palette, palette + gPaletteSize, grid.palette);
+	if(memcmp(&grid, &g.cellGrid, sizeof(CellGrid)) != 0) {
+		g.cellGrid = grid;
+		g.cellGridDirty = true;
+	}
+}
+
+bool UpdateCellInstance(int id, int x, int y, int z, unsigned char shade) {
+	// a cell off the grid cannot be drawn, so drop whatever the id showed before and tell the caller
+	if(x < 0 || x >= gCellAxis || y < 0 || y >= gCellAxis || z < 0 || z >= gCellAxis) {
+		RemoveCellInstance(id);
+		return false;
+	}
+	ensureCellBuffers();
+	if(id >= static_cast<int>(g.cellSlots.size())) {
+		g.cellSlots.resize(id + 1, -1);
+	}
+
+	int slot = g.cellSlots[id];
+	if(slot < 0) {
+		slot = static_cast<int>(g.cells.size());
+		g.cellSlots[id] = slot;
+		g.cellIds.push_back(id);
+		g.cells.push_back({});
+	}
+
+	g.cells[slot] = glm::uvec2(x | y << 10 | z << 20, shade);
+	g.dirtyCells.push_back(slot);
+	return true;
+}
+
+void RemoveCellInstance(int id) {
+	if(id >= static_cast<int>(g.cellSlots.size()) || g.cellSlots[id] < 0) {
+		return;
+	}
+
+	// fill the hole with the last instance so the live slots stay contiguous
+	int slot = g.cellSlots[id];
+	int last = static_cast<int>(g.cells.size()) - 1;
+	if(slot != last) {
+		g.cells[slot] = g.cells[last];
+		g.cellIds[slot] = g.cellIds[last];
+		g.cellSlots[g.cellIds[slot]] = slot;
+		g.dirtyCells.push_back(slot);
+	}
+	g.cells.pop_back();
+	g.cellIds.pop_back();
+	g.cellSlots[id] = -1;
+}
+
+void DrawCellInstances(void) {
+	ensureCellBuffers();
+	g.drawCells = true;
+}
+
+void DrawCellInstanceWires(Color color) {
+	ensureCellBuffers();
+	if(g.cellGrid.wire != color) {
+		g.cellGrid.wire = color;
+		g.cellGridDirty = true;
+	}
+	g.drawCellWires = true;
+}
+
+void rlEnableGpuCulling(void) {
+	g.gpuCulling = true;
+}
+
+void rlDisableGpuCulling(void) {
+	g.gpuCulling = false;
+}
+
+int GetCellInstanceCount(void) {
+	return static_cast<int>(g.cells.size());
+}
+
+// the level of detail counts and the brick tiles follow the mask, only the blocks and bricks of cells that flipped since voxelBits are touched unless rebuild is set
+static void updateVoxelBricks(const uint32_t* bits, glm::ivec3 dims, bool rebuild) {
+	glm::ivec3 blockDims = (dims + 1) / 2;
+	glm::ivec3 brickDims = (dims + gVoxelBrick - 1) / gVoxelBrick;
+	size_t blocks = blockDims.x * blockDims.y * blockDims.z;
+	size_t bricks = brickDims.x * brickDims.y * brickDims.z;
+	int cells = dims.x * dims.y * dims.z;
+	if(rebuild) {
+		g.voxelLod.assign(blocks + bricks, 0);
+		g.voxelTiles.assign(2 * bricks, 0);
+		g.dirtyTiles.clear();
+		g.voxelTilesStale = true;
+	}
+
+	for(int word = 0; word < (cells + 31) / 32; word++) {
+		uint32_t changed = rebuild ? bits[word] : bits[word] ^ g.voxelBits[word];
+		for(int bit = 0; changed != 0; bit++, changed >>= 1) {
+			int id = word * 32 + bit;
+			if(!(changed & 1) || id >= cells) {
+				continue;
+			}
+			glm::ivec3 cell = { id / (dims.y * dims.z), id / dims.z % dims.y, id % dims.z };
+			glm::ivec3 block = cell / 2;
+			glm::ivec3 brick = cell / gVoxelBrick;
+			glm::ivec3 local = cell % gVoxelBrick;
+			int brickId = (brick.x * brickDims.y + brick.y) * brickDims.z + brick.z;
+			int tileBit = (local.x * gVoxelBrick + local.y) * gVoxelBrick + local.z;
+			int delta = (bits[word] >> bit) & 1 ? 1 : -1;
+			g.voxelLod[(block.x * blockDims.y + block.y) * blockDims.z + block.z] += delta;
+			g.voxelLod[blocks + brickId] += delta;
+			g.voxelTiles[2 * brickId + tileBit / 32] ^= 1u << (tileBit % 32);
+			if(!rebuild) {
+				g.dirtyTiles.push_back(brickId);
+			}
+		}
+	}
+}
+
+// shared by both voxel grid entry points, shades and palette are null for the gradient
+static void drawVoxelGrid(const unsigned int* bits, const unsigned char* shades, const Color* palette, int width, int height, int depth, Vector3 position, float size, Color inner, Color outer) {
+	int cells = width * height * depth;
+	if(cells <= 0 || (!g.rayMarching && cells > gMaxCells)) {
+		return;
+	}
+
+	ensureVoxelGridBuffers({ width, height, depth });
+	if(!g.rayMarching) {
+		ensureVoxelBuffers();
+	}
+	size_t words = (cells + 31) / 32;
+	glm::ivec3 dims = { width, height, depth };
+	bool resized = dims != g.voxel.dims || g.voxelBits.size() != words;
+	if(resized || memcmp(g.voxelBits.data(), bits, words * sizeof(uint32_t)) != 0) {
+		updateVoxelBricks(bits, dims, resized || g.voxelLod.empty());
+		g.voxelBits.assign(bits, bits + words);
+		g.voxelDirty = true;
+	}
+
+	if(shades) {
+		size_t paletteBytes = sizeof(Color) * gPaletteSize;
+		if(g.voxelShades.size() != paletteBytes + cells || memcmp(g.voxelShades.data(), palette, paletteBytes) != 0 || memcmp(g.voxelShades.data() + paletteBytes, shades, cells) != 0) {
+			g.voxelShades.resize(paletteBytes + cells);
+			memcpy(g.voxelShades.data(), palette, paletteBytes);
+			memcpy(g.voxelShades.data() + paletteBytes, shades, cells);
+			g.voxelShadesDirty = true;
+			g.voxelDirty = true;
+		}
+	}
+	else {
+		g.voxelShades.clear();
+	}
+
+	VoxelConstants voxel = g.voxel;
+	voxel.dims = { width, height, depth };
+	if(voxel.dims != g.voxel.dims) {
+		g.voxelBricksStale = true;
+	}
+	voxel.size = size;
+	voxel.pos = position;
+	voxel.inner = inner;
+	voxel.outer = outer;
+	voxel.shaded = shades != nullptr;
+	if(memcmp(&voxel, &g.voxel, sizeof(VoxelConstants)) != 0) {
+		g.voxel = voxel;
+		g.voxelDirty = true;
+	}
+
+	g.drawVoxels = true;
+}
+
+void DrawVoxelGrid(const unsigned int* bits, int width, int height, int depth, Vector3 position, float size, Color inner, Color outer) {
+	drawVoxelGrid(bits, nullptr, nullptr, width, height, depth, position, size, inner, outer);
+}
+
+void DrawVoxelGridShaded(const unsigned int* bits, const unsigned char* shades, int width, int height, int depth, Vector3 position, float size, const Color* palette) {
+	drawVoxelGrid(bits, shades, palette, width, height, depth, position, size, Color{}, Color{});
+}
+
+void DrawDensityMap(const unsigned char* alpha, int width, int depth, Vector3 position, float size, Color color) {
+	int squares = width * depth;
+	if(squares <= 0 || squares > gMaxDensitySquares) {
+		return;
+	}
+	ensureDensityBuffer();
+
+	DensityHeader header = { { width, depth }, position, size, color };
+	size_t bytes = sizeof(DensityHeader) + squares;
+	if(g.densityMap.size() != bytes || memcmp(g.densityMap.data(), &header, sizeof(DensityHeader)) != 0 || memcmp(g.densityMap.data() + sizeof(DensityHeader), alpha, squares) != 0) {
+		g.densityMap.resize(bytes);
+		memcpy(g.densityMap.data(), &header, sizeof(DensityHeader));
+		memcpy(g.densityMap.data() + sizeof(DensityHeader), alpha, squares);
+		g.densityDirty = true;
+	}
+
+	g.drawDensity = true;
+}
+
+void rlEnableOcclusionCulling(void) {
+	g.occlusionCulling = true;
+}
+
+void rlDisableOcclusionCulling(void) {
+	g.occlusionCulling = false;
+}
+
+void rlEnableLod(void) {
+	g.lod = true;
+}
+
+void rlDisableLod(void) {
+	g.lod = false;
+}
+
+void rlEnableRayMarching(void) {
+	g.rayMarching = true;
+}
+
+void rlDisableRayMarching(void) {
+	g.rayMarching = false;
+}
+
+GpuTimings GetGpuTimings(void) {
+	return g.gpuTimings;
+}
+
+StartupTimings GetStartupTimings(void) {
+	return g.startup;
+}
+
+FramePacing GetFramePacing(void) {
+	FramePacing pacing = {};
+	uint64_t count = std::min<uint64_t>(g.frameSamples, gFrameTimeSamples);
+	uint64_t paced = 0;
+	for(uint64_t i = 0; i < count; i++) {
+		pacing.sleep += g.paceSleep[i];
+		pacing.spin += g.paceSpin[i];
+		if(g.paceSleep[i] > 0.0f || g.paceSpin[i] > 0.0f) {
+			pacing.jitter += std::abs(g.paceError[i]);
+			pacing.maxError = std::max(pacing.maxError, g.paceError[i]);
+			paced++;
+		}
+	}
+	if(count > 0) {
+		pacing.sleep *= 1000.0f / count;
+		pacing.spin *= 1000.0f / count;
+	}
+	if(paced > 0) {
+		pacing.jitter *= 1000.0f / paced;
+	}
+	pacing.maxError *= 1000.0f;
+	pacing.presentMode = static_cast<int>(g.mode);
+	return pacing;
+}
+
+const char* TextFormat(const char* text, ...) {
+	// a few rotating buffers so several results can be used in the same expression
+	static char buffers[4][1024];
+	static int index = 0;
+
+	char* buffer = buffers[index];
+	index = (index + 1) % 4;
+
+	va_list args;
+	va_start(args, text);
+	vsnprintf(buffer, sizeof(buffers[0]), text, args);
+	va_end(args);
+
+	return buffer;
+}
+
+void DrawText(const char* text, int posX, int posY, int fontSize, Color color) {
+	glm::vec2 pen = { posX, posY };
+	for(const char* c = text; *c; c++) {
+		if(*c == '\n') {
+			pen = { posX, pen.y + fontSize + fontSize / 8 };
+		}
+		else {
+			if(*c != ' ' && g.glyphs.size() < gMaxGlyphs) {
+				g.glyphs.push_back(Glyph{ pen, static_cast<float>(fontSize), static_cast<uint32_t>(static_cast<unsigned char>(*c)), color });
+			}
+			pen.x += fontSize;
+		}
+	}
+}
+
+int GetFPS(void) {
+	uint64_t count = std::min<uint64_t>(g.frameSamples, gFrameTimeSamples);
+	float total = 0.0f;
+	for(uint64_t i = 0; i < count; i++) {
+		total += g.frameTimes[i];
+	}
+	return total > 0.0f ? static_cast<int>(std::round(count / total)) : 0;
+}
+
+float GetFrameTime(void) {
+	return g.frameSamples ? g.frameTimes[(g.frameSamples - 1) % gFrameTimeSamples] : 0.0f;
+}
+
+double GetTime(void) {
+	return getTime();
 }
 
 void DrawFPS(int posX, int posY) {
+	int fps = GetFPS();
+	Color color = LIME;
+	if(fps < 15) {
+		color = RED;
+	}
+	else if(fps < 30) {
+		color = ORANGE;
+	}
+	DrawText(TextFormat("%d FPS", fps), posX, posY, 16, color);
+
+	uint64_t count = std::min<uint64_t>(g.frameSamples, gFrameTimeSamples);
+	if(count == 0) {
+		return;
+	}
 
+	float sorted[gFrameTimeSamples];
+	std::copy(g.frameTimes, g.frameTimes + count, sorted);
+	auto percentile = [&](int p) {
+		float* nth = sorted + (count - 1) * p / 100;
+		std::nth_element(sorted, nth, sorted + count);
+		return *nth * 1000.0f;
+	};
+	float p50 = percentile(50);
+	float p95 = percentile(95);
+	float p99 = percentile(99);
+	DrawText(TextFormat("p50 %.1f p95 %.1f p99 %.1f ms", p50, p95, p99), posX, posY + 18, 16, color);
 }
 
 float Vector3DotProduct(Vector3 v1, Vector3 v2) {
@@ -4,7 +4,12 @@
 #include "rldefs.hpp"
 
 void SetConfigFlags(unsigned int flags);                    // Setup init configuration flags (view FLAGS)
-void SetTargetFPS(int fps);                                 // Set target FPS (maximum)
+void SetWindowState(unsigned int flags);                    // Set window configuration state using flags (only FLAG_VSYNC_HINT)
+void ClearWindowState(unsigned int flags);                  // Clear window configuration state flags (only FLAG_VSYNC_HINT)
+void SetTargetFPS(int fps);                                 // Set target FPS (maximum), waits by sleeping and spins only the last fraction of a millisecond
+int GetFPS(void);                                           // Get current FPS (averaged over the last 256 frames)
+float GetFrameTime(void);                                   // Get time in seconds for last frame drawn (delta time)
+double GetTime(void);                                       // Get elapsed time in seconds since InitWindow()
 
 void InitWindow(int width, int height, const char* title);  // Initialize window and OpenGL context
 bool WindowShouldClose(void);                               // Check if KEY_ESCAPE pressed or Close icon pressed
@@ -17,6 +22,7 @@ Vector2 GetMouseDelta(void);                            // Get mouse delta betwe
 float GetMouseWheelMove(void);                          // Get mouse wheel movement Y
 
 Matrix GetCameraMatrix(Camera camera);                      // Get camera transform matrix (view matrix)
+Matrix GetCameraProjectionMatrix(Camera camera);            // Get camera projection matrix (reverse-Z, infinite far plane)
 
 void ClearBackground(Color color);                          // Set background color (framebuffer clear color)
 void BeginDrawing(void);                                    // Setup canvas (framebuffer) to start drawing
@@ -25,10 +31,55 @@ void BeginMode3D(Camera3D camera);                          // Begin 3D mode wit
 void EndMode3D(void);                                       // Ends 3D mode and returns to default 2D orthographic mode
 
 void rlEnableBackfaceCulling(void);               // Enable backface culling
+void rlDisableBackfaceCulling(void);              // Disable backface culling
 
 void DrawCube(Vector3 position, float width, float height, float length, Color color);             // Draw cube
 void DrawCubeWires(Vector3 position, float width, float height, float length, Color color);        // Draw cube wires
-void DrawFPS(int posX, int posY);                                                     // Draw current FPS
+void DrawFPS(int posX, int posY);                                                     // Draw current FPS and frame time p50/p95/p99
+void DrawText(const char* text, int posX, int posY, int fontSize, Color color);       // Draw text (using the built-in 8x8 font)
+
+const char* TextFormat(const char* text, ...);              // Text formatting with variables (sprintf() style)
+
+// Retained cell instances, kept on the GPU between frames as 8 byte grid cells; only instances changed since the last frame are uploaded
+void SetCellGrid(Vector3 position, float size, const Color* palette);  // Place cell (x, y, z) at position + (x, y, z)*size with size edges, colored by the 256 entry palette
+bool UpdateCellInstance(int id, int x, int y, int z, unsigned char shade);  // Add or replace the cell instance with the given id (coordinates 0 to 1023, colored palette[shade]), false and removed when outside
+void RemoveCellInstance(int id);                            // Remove the cell instance with the given id (if present)
+void DrawCellInstances(void);                               // Draw all cell instances this frame
+void DrawCellInstanceWires(Color color);                    // Draw a wire cube around every cell instance this frame
+int GetCellInstanceCount(void);                             // Get number of cell instances
+void rlEnableGpuCulling(void);                              // Frustum cull cell instances in a compute pass and draw the survivors indirectly
+void rlDisableGpuCulling(void);                             // Draw every cell instance (default)
+void rlEnableOcclusionCulling(void);                        // Skip voxel bricks hidden behind last frame's visible bricks (needs drawIndirectFirstInstance, otherwise ignored)
+void rlDisableOcclusionCulling(void);                       // Draw every voxel face (default)
+void rlEnableLod(void);                                     // Draw distant voxel bricks as 2x2x2 blocks or single cubes (needs drawIndirectFirstInstance) and skip wire cubes under a pixel
+void rlDisableLod(void);                                    // Draw every voxel cell and wire cube at full detail (default)
+void rlEnableRayMarching(void);                             // Draw the voxel grid by marching each pixel's ray through its 4x4x4 bricks, cost follows resolution rather than live cells and grids of any size are drawn
+void rlDisableRayMarching(void);                            // Rasterize the visible faces of the voxel grid, up to 50x50x50 cells (default)
+
+void DrawVoxelGrid(const unsigned int* bits, int width, int height, int depth, Vector3 position, float size, Color inner, Color outer);  // Draw a cube per set bit of a width x height x depth occupancy mask (bit (x*height + y)*depth + z), colored from inner at the center to outer at the corners
+void DrawVoxelGridShaded(const unsigned int* bits, const unsigned char* shades, int width, int height, int depth, Vector3 position, float size, const Color* palette);  // Draw a voxel grid colored by palette[shades[cell]], one byte per cell in the order of the bits and 256 palette entries
+void DrawDensityMap(const unsigned char* alpha, int width, int depth, Vector3 position, float size, Color color);  // Draw width x depth flat squares on the XZ plane as one quad, square (x, z) centered at position + (x, 0, z)*size with color.a scaled by alpha[x*depth + z]
+
+GpuTimings GetGpuTimings(void);                             // Get GPU pass timings of the most recently completed frame
+StartupTimings GetStartupTimings(void);                     // Get InitWindow phase, pipeline build and time-to-first-frame timings
+FramePacing GetFramePacing(void);                           // Get frame limiter sleep, spin and deadline error over the last 256 frames
+
+// Late latching, latch is called right before submission with the camera given to BeginMode3D and returns the camera to render with.
+// Input is then polled just before the call, so GetMouseDelta() and GetMouseWheelMove() inside it return movement the application has not seen yet
+// (it sees the same movement next frame). Culling and all 3D passes use the returned camera.
+void SetCameraLatch(Camera3D (*latch)(Camera3D camera));    // Set the late latch callback (NULL to disable)
+float GetInputLatency(void);                                // Get milliseconds from polling input to submitting the frame it positioned, averaged over the last 256 frames
+
+// Headless rendering (FLAG_WINDOW_HEADLESS), frames are drawn into an offscreen target and copied to host memory once GetFramePixels() has been called.
+// The pixels trail by the frames in flight and stay valid until the next EndDrawing(); there is no input and WindowShouldClose() is always false.
+const unsigned char* GetFramePixels(int* width, int* height);  // Get the RGBA8 pixels of the headless frame drawn two EndDrawing() calls ago (NULL with a window, or until a frame drawn after the first call is done)
+
+// Frame capture, a finished frame is copied into a ring of host-readable buffers and handed to an encoder pool once its fence has signalled,
+// a few frames later, so neither the GPU nor the disk is waited on. File names ending in .png are written as PNG, anything else as binary PPM.
+void TakeScreenshot(const char* fileName);                  // Capture the frame ended by the next EndDrawing()
+void BeginFrameCapture(const char* fileNameFormat);         // Capture every frame until EndFrameCapture(), fileNameFormat takes the capture's frame number (e.g. "frame%05d.png")
+void EndFrameCapture(void);                                 // Stop capturing, frames already copied are still written
+CaptureStats GetCaptureStats(void);                         // Get capture counters
 
 float Vector3DotProduct(Vector3 v1, Vector3 v2);
 
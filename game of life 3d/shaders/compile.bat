@@ -1,4 +1,31 @@
 glslc wire.vert -o wire.vert.spv --target-env=vulkan1.3
 glslc solid.vert -o solid.vert.spv --target-env=vulkan1.3
+glslc face.vert -o face.vert.spv --target-env=vulkan1.3
 glslc cube.frag -o cube.frag.spv --target-env=vulkan1.3
+glslc text.vert -o text.vert.spv --target-env=vulkan1.3
+glslc glyph.frag -o glyph.frag.spv --target-env=vulkan1.3
+glslc density.vert -o density.vert.spv --target-env=vulkan1.3
+glslc square.frag -o square.frag.spv --target-env=vulkan1.3
+glslc voxel.comp -o voxel.comp.spv --target-env=vulkan1.3
+glslc cull.comp -o cull.comp.spv --target-env=vulkan1.3
+glslc hiz.comp -o hiz.comp.spv --target-env=vulkan1.3
+glslc bricks.comp -o bricks.comp.spv --target-env=vulkan1.3
+glslc screen.vert -o screen.vert.spv --target-env=vulkan1.3
+glslc march.frag -o march.frag.spv --target-env=vulkan1.3
+
+python convert.py wire.vert.spv ../include/rlvk/wire.h wire_vert
+python convert.py solid.vert.spv ../include/rlvk/solid.h solid_vert
+python convert.py face.vert.spv ../include/rlvk/face.h face_vert
+python convert.py cube.frag.spv ../include/rlvk/cube.h cube_frag
+python convert.py text.vert.spv ../include/rlvk/text.h text_vert
+python convert.py glyph.frag.spv ../include/rlvk/glyph.h glyph_frag
+python convert.py density.vert.spv ../include/rlvk/density.h density_vert
+python convert.py square.frag.spv ../include/rlvk/square.h square_frag
+python convert.py voxel.comp.spv ../include/rlvk/voxel.h voxel_comp
+python convert.py cull.comp.spv ../include/rlvk/cull.h cull_comp
+python convert.py hiz.comp.spv ../include/rlvk/hiz.h hiz_comp
+python convert.py bricks.comp.spv ../include/rlvk/bricks.h bricks_comp
+python convert.py screen.vert.spv ../include/rlvk/screen.h screen_vert
+python convert.py march.frag.spv ../include/rlvk/march.h march_frag
+
 pause
\ No newline at end of file
@@ -2,23 +2,26 @@
 import sys
 import struct
 
-def emit_c_array(input_path, output_path):
+def emit_c_array(input_path, output_path, name):
     with open(input_path, "rb") as f:
         data = f.read()
 
+    guard = output_path.replace("\\", "/").split("/")[-1].replace(".", "_").upper()
     with open(output_path, "w") as out:
-        out.write("const uint32_t spirv_shader[] = {\n")
+        out.write(f"#ifndef {guard}\n#define {guard}\n#include <cstdint>\n\n")
+        out.write(f"static const uint32_t {name}[] = {{\n")
         for i, (word,) in enumerate(struct.iter_unpack("<I", data)):
             out.write(f"  0x{word:08x},")
             out.write("\n" if (i + 1) % 4 == 0 else " ")
         out.write("\n};\n")
-        out.write(f"const size_t spirv_shader_size = {len(data) // 4};\n")
+        out.write(f"static const size_t {name}_size = {len(data) // 4};\n\n#endif\n")
 
 if __name__ == "__main__":
-    if len(sys.argv) != 3:
-        print("Usage: python spv_to_c_array.py input.spv output.h")
+    if len(sys.argv) != 4:
+        print("Usage: python spv_to_c_array.py input.spv output.h array_name")
         sys.exit(1)
     
     input_path = sys.argv[1]
     output_path = sys.argv[2]
-    emit_c_array(input_path, output_path)
\ No newline at end of file
+    name = sys.argv[3]
+    emit_c_array(input_path, output_path, name)
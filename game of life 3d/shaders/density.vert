@@ -0,0 +1,52 @@
+#version 460
+
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_shader_explicit_arithmetic_types : require
+
+// one flat quad on the XZ plane covering a whole density map, square.frag picks the square under each fragment
+vec2 corners[6] = {
+    { 0.0f, 0.0f },
+    { 0.0f, 1.0f },
+    { 1.0f, 0.0f },
+    { 1.0f, 1.0f },
+    { 1.0f, 0.0f },
+    { 0.0f, 1.0f }
+};
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outSquare;
+layout(location = 2) flat out uvec2 outMap;
+
+// square (x, z) is centered at position + (x, 0, z) * size
+layout(buffer_reference, scalar) restrict readonly buffer DensityMap {
+    ivec2 dims;
+    vec3 position;
+    float size;
+    u8vec4 color;
+};
+
+// the camera as of just before submission, written by the host into a per-frame buffer after recording
+layout(buffer_reference, scalar) restrict readonly buffer View {
+    mat4 transform;
+    vec4 planes[6];
+    vec3 eye;
+};
+
+layout(push_constant, scalar) uniform constants {
+    DensityMap map;
+    uint offset;
+    mat4 transform;
+    vec3 eye;
+    View view;
+} pcs;
+
+void main() {
+    vec2 square = corners[gl_VertexIndex] * vec2(pcs.map.dims);
+
+    outColor = vec4(pcs.map.color) / vec4(255.0f);
+    outSquare = square;
+    outMap = uvec2(pcs.map);
+    gl_Position = pcs.view.transform * vec4(pcs.map.position + vec3(square.x - 0.5f, 0.0f, square.y - 0.5f) * pcs.map.size, 1.0f);
+}
\ No newline at end of file
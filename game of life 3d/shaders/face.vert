@@ -0,0 +1,73 @@
+#version 460
+
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_shader_explicit_arithmetic_types : require
+
+// the four corners of each face in the order -x, -y, -z, +x, +y, +z, drawn as the triangles 0 1 2 and 3 2 1
+vec3 vertices[24] = {
+    { -0.5f,  0.5f, -0.5f },
+    { -0.5f,  0.5f,  0.5f },
+    { -0.5f, -0.5f, -0.5f },
+    { -0.5f, -0.5f,  0.5f },
+    { -0.5f, -0.5f,  0.5f },
+    {  0.5f, -0.5f,  0.5f },
+    { -0.5f, -0.5f, -0.5f },
+    {  0.5f, -0.5f, -0.5f },
+    {  0.5f, -0.5f, -0.5f },
+    {  0.5f,  0.5f, -0.5f },
+    { -0.5f, -0.5f, -0.5f },
+    { -0.5f,  0.5f, -0.5f },
+    {  0.5f, -0.5f, -0.5f },
+    {  0.5f, -0.5f,  0.5f },
+    {  0.5f,  0.5f, -0.5f },
+    {  0.5f,  0.5f,  0.5f },
+    { -0.5f,  0.5f, -0.5f },
+    {  0.5f,  0.5f, -0.5f },
+    { -0.5f,  0.5f,  0.5f },
+    {  0.5f,  0.5f,  0.5f },
+    { -0.5f, -0.5f,  0.5f },
+    { -0.5f,  0.5f,  0.5f },
+    {  0.5f, -0.5f,  0.5f },
+    {  0.5f,  0.5f,  0.5f }
+};
+
+layout(location = 0) out vec4 outColor;
+
+struct Cube {
+    vec3 position;
+    vec3 size;
+    u8vec4 color;
+};
+
+layout(buffer_reference, scalar) restrict readonly buffer Cubes {
+    Cube cubes[];
+};
+
+// a visible face, cube index << 3 | face
+layout(buffer_reference, scalar) restrict readonly buffer Faces {
+    uint faces[];
+};
+
+// the camera as of just before submission, written by the host into a per-frame buffer after recording
+layout(buffer_reference, scalar) restrict readonly buffer View {
+    mat4 transform;
+    vec4 planes[6];
+    vec3 eye;
+};
+
+layout(push_constant, scalar) uniform constants {
+    Cubes bda;
+    uint offset;
+    mat4 transform;
+    vec3 eye;
+    View view;
+} pcs;
+
+void main() {
+    uint face = Faces(pcs.bda).faces[gl_InstanceIndex + pcs.offset];
+    Cube cur = pcs.bda.cubes[face >> 3];
+    
+    outColor = vec4(cur.color) / vec4(255.0f);
+    gl_Position = pcs.view.transform * vec4(vertices[(face & 7) * 4 + gl_VertexIndex] * cur.size + cur.position, 1.0f);
+}
\ No newline at end of file
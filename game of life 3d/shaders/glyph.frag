@@ -0,0 +1,17 @@
+#version 460
+
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec2 inTexel;
+layout(location = 2) flat in uvec2 inBits;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    uvec2 texel = min(uvec2(inTexel), uvec2(7));
+    uint row = (texel.y < 4 ? inBits.x : inBits.y) >> ((texel.y & 3) * 8);
+    if(((row >> texel.x) & 1) == 0) {
+        discard;
+    }
+
+    outColor = inColor;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#version 460
+
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_shader_explicit_arithmetic_types : require
+
+// marches the ray of a fragment through the voxel grid and colors and depth tests the first live cell the way face.vert would,
+// so the marched grid matches the rasterized one and mixes with other geometry through the depth buffer
+// the cells are read as one 64 bit tile per 4x4x4 brick and an empty tile is crossed in a single step,
+// so the cost follows the pixels and the bricks a ray passes, not the number of live cells
+layout(location = 0) in vec2 inNdc;
+layout(location = 1) flat in uvec2 inGrid;
+
+layout(location = 0) out vec4 outColor;
+
+// two words per brick in the order of the bricks, cell (x, y, z) of a brick is bit (x * 4 + y) * 4 + z
+layout(buffer_reference, scalar) restrict readonly buffer Tiles {
+    uint words[];
+};
+
+// a 256 color palette followed by one palette index per cell, in the order of the occupancy bits
+layout(buffer_reference, scalar) restrict readonly buffer Shades {
+    u8vec4 palette[256];
+    uint8_t shades[];
+};
+
+// the camera as of just before submission, written by the host into a per-frame buffer after recording
+layout(buffer_reference, scalar) restrict readonly buffer View {
+    mat4 transform;
+    vec4 planes[6];
+    vec3 eye;
+    float pixelScale;
+    mat4 inverse;
+};
+
+layout(buffer_reference, scalar) restrict readonly buffer Grid {
+    Tiles tiles;
+    Shades shades;
+    View view;
+    ivec3 dims;
+    float size;
+    vec3 position;
+    u8vec4 inner;
+    u8vec4 outer;
+    uint shaded;
+};
+
+u8vec4 cellColor(Grid grid, ivec3 cell) {
+    if(grid.shaded != 0) {
+        return grid.shades.palette[uint(grid.shades.shades[(cell.x * grid.dims.y + cell.y) * grid.dims.z + cell.z])];
+    }
+    vec3 center = vec3(grid.dims) / 2.0f;
+    float gradient = distance(vec3(cell), center) / length(center);
+    return u8vec4(mix(vec4(grid.inner), vec4(grid.outer), gradient));
+}
+
+void main() {
+    Grid grid = Grid(inGrid);
+    View view = grid.view;
+
+    // the ray starts on the near plane, in grid space where cell c covers [c, c + 1)
+    vec4 near = view.inverse * vec4(inNdc, 1.0f, 1.0f);
+    vec3 start = near.xyz / near.w;
+    vec3 dir = normalize(start - view.eye);
+    dir = mix(dir, vec3(1e-7f), equal(dir, vec3(0.0f)));
+    vec3 inv = 1.0f / dir;
+    vec3 origin = (view.eye - grid.position) / grid.size + 0.5f;
+    float t = distance(start, view.eye) / grid.size;
+
+    vec3 t0 = -origin * inv;
+    vec3 t1 = (vec3(grid.dims) - origin) * inv;
+    vec3 enter = min(t0, t1);
+    vec3 leave = max(t0, t1);
+    t = max(t, max(enter.x, max(enter.y, enter.z)));
+    float end = min(leave.x, min(leave.y, leave.z));
+
+    ivec3 bricks = (grid.dims + 3) / 4;
+    bvec3 ahead = greaterThan(dir, vec3(0.0f));
+    int steps = grid.dims.x + grid.dims.y + grid.dims.z;
+    for(int i = 0; i < steps && t < end; i++) {
+        // nudged along the ray so a point on a boundary lands in the cell being entered
+        ivec3 cell = clamp(ivec3(floor(origin + dir * (t + 1e-4f))), ivec3(0), grid.dims - 1);
+        ivec3 brick = cell >> 2;
+        uint tile = uint((brick.x * bricks.y + brick.y) * bricks.z + brick.z) * 2;
+        uvec2 words = uvec2(grid.tiles.words[tile], grid.tiles.words[tile + 1]);
+
+        vec3 lo;
+        vec3 hi;
+        if(words == uvec2(0)) {
+            lo = vec3(brick * 4);
+            hi = vec3(min(brick * 4 + 4, grid.dims));
+        }
+        else {
+            ivec3 local = cell & 3;
+            uint bit = uint((local.x * 4 + local.y) * 4 + local.z);
+            if((((bit < 32 ? words.x : words.y) >> (bit & 31)) & 1) != 0) {
+                vec4 clip = view.transform * vec4(view.eye + dir * (t * grid.size), 1.0f);
+                outColor = vec4(cellColor(grid, cell)) / vec4(255.0f);
+                gl_FragDepth = clip.z / clip.w;
+                return;
+            }
+            lo = vec3(cell);
+            hi = lo + 1.0f;
+        }
+
+        vec3 exits = (mix(lo, hi, ahead) - origin) * inv;
+        t = min(exits.x, min(exits.y, exits.z));
+    }
+    discard;
+}
\ No newline at end of file
@@ -0,0 +1,28 @@
+#version 460
+
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_EXT_scalar_block_layout : require
+
+// one triangle covering the screen for march.frag, which finds the voxel grid behind each fragment
+layout(location = 0) out vec2 outNdc;
+layout(location = 1) flat out uvec2 outGrid;
+
+layout(buffer_reference, scalar) restrict readonly buffer Grid {
+    uint tiles;
+};
+
+layout(push_constant, scalar) uniform constants {
+    Grid grid;
+    uint offset;
+    mat4 transform;
+    vec3 eye;
+} pcs;
+
+void main() {
+    vec2 ndc = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2.0f - 1.0f;
+
+    outNdc = ndc;
+    outGrid = uvec2(pcs.grid);
+    gl_Position = vec4(ndc, 0.0f, 1.0f);
+}
\ No newline at end of file
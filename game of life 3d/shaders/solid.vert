@@ -1,46 +1,36 @@
 #version 460
 
 #extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_buffer_reference_uvec2 : require
 #extension GL_EXT_scalar_block_layout : require
 #extension GL_EXT_shader_explicit_arithmetic_types : require
 
-vec3 vertices[36] = {
+// the four corners of each face in the order -x, -y, -z, +x, +y, +z, drawn as the triangles 0 1 2 and 3 2 1
+vec3 vertices[24] = {
     { -0.5f,  0.5f, -0.5f },
     { -0.5f,  0.5f,  0.5f },
     { -0.5f, -0.5f, -0.5f },
     { -0.5f, -0.5f,  0.5f },
-    { -0.5f, -0.5f, -0.5f },
-    { -0.5f,  0.5f,  0.5f },
     { -0.5f, -0.5f,  0.5f },
     {  0.5f, -0.5f,  0.5f },
     { -0.5f, -0.5f, -0.5f },
     {  0.5f, -0.5f, -0.5f },
-    { -0.5f, -0.5f, -0.5f },
-    {  0.5f, -0.5f,  0.5f },
     {  0.5f, -0.5f, -0.5f },
     {  0.5f,  0.5f, -0.5f },
     { -0.5f, -0.5f, -0.5f },
     { -0.5f,  0.5f, -0.5f },
-    { -0.5f, -0.5f, -0.5f },
-    {  0.5f,  0.5f, -0.5f },
     {  0.5f, -0.5f, -0.5f },
     {  0.5f, -0.5f,  0.5f },
     {  0.5f,  0.5f, -0.5f },
     {  0.5f,  0.5f,  0.5f },
-    {  0.5f,  0.5f, -0.5f },
-    {  0.5f, -0.5f,  0.5f },
     { -0.5f,  0.5f, -0.5f },
     {  0.5f,  0.5f, -0.5f },
     { -0.5f,  0.5f,  0.5f },
     {  0.5f,  0.5f,  0.5f },
-    { -0.5f,  0.5f,  0.5f },
-    {  0.5f,  0.5f, -0.5f },
     { -0.5f, -0.5f,  0.5f },
     { -0.5f,  0.5f,  0.5f },
     {  0.5f, -0.5f,  0.5f },
-    {  0.5f,  0.5f,  0.5f },
-    {  0.5f, -0.5f,  0.5f },
-    { -0.5f,  0.5f,  0.5f }
+    {  0.5f,  0.5f,  0.5f }
 };
 
 layout(location = 0) out vec4 outColor;
@@ -55,15 +45,69 @@ layout(buffer_reference, scalar) restrict readonly buffer Cubes {
     Cube cubes[];
 };
 
+// a grid cell as x | y << 10 | z << 20 and its palette index
+layout(buffer_reference, scalar) restrict readonly buffer Cells {
+    uvec2 cells[];
+};
+
+// what the packed cells are decoded against, cell (x, y, z) is centered at position + (x, y, z) * size
+layout(buffer_reference, scalar) restrict readonly buffer Grid {
+    vec3 position;
+    float size;
+    u8vec4 wire;
+    u8vec4 palette[256];
+};
+
+// the camera as of just before submission, written by the host into a per-frame buffer after recording
+layout(buffer_reference, scalar) restrict readonly buffer View {
+    mat4 transform;
+    vec4 planes[6];
+    vec3 eye;
+};
+
 layout(push_constant, scalar) uniform constants {
     Cubes bda;
     uint offset;
     mat4 transform;
+    vec3 eye;
+    View view;
+    Grid grid;          // set when bda holds packed cells instead of cubes
 } pcs;
 
+Cube loadCube(uint index) {
+    if(uvec2(pcs.grid) == uvec2(0)) {
+        return pcs.bda.cubes[index];
+    }
+    uvec2 cell = Cells(pcs.bda).cells[index];
+    Cube cube;
+    cube.position = pcs.grid.position + vec3(cell.x & 0x3ff, (cell.x >> 10) & 0x3ff, cell.x >> 20) * pcs.grid.size;
+    cube.size = vec3(pcs.grid.size);
+    cube.color = pcs.grid.palette[cell.y];
+    return cube;
+}
+
 void main() {
-    Cube cur = pcs.bda.cubes[gl_VertexIndex / 36 + pcs.offset];
-    
+    Cube cur = loadCube(gl_InstanceIndex + pcs.offset);
     outColor = vec4(cur.color) / vec4(255.0f);
-    gl_Position = pcs.transform * vec4(vertices[gl_VertexIndex % 36] * cur.size + cur.position, 1.0f);
+
+    // quads 0 to 2 are the x, y and z faces turned toward the eye, exactly the ones backface culling would keep,
+    // a quad is dropped when the eye lies between the two planes of its axis
+    // quads 3 to 8 are all six faces, for drawing with backface culling disabled
+    uint quad = gl_VertexIndex / 4;
+    uint face = quad - 3;
+    if(quad < 3) {
+        float extent = cur.size[quad] * 0.5f;
+        if(pcs.view.eye[quad] > cur.position[quad] + extent) {
+            face = quad + 3;
+        }
+        else if(pcs.view.eye[quad] < cur.position[quad] - extent) {
+            face = quad;
+        }
+        else {
+            gl_Position = vec4(0.0f, 0.0f, -1.0f, 1.0f);
+            return;
+        }
+    }
+
+    gl_Position = pcs.view.transform * vec4(vertices[face * 4 + gl_VertexIndex % 4] * cur.size + cur.position, 1.0f);
 }
\ No newline at end of file
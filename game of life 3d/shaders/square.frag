@@ -0,0 +1,32 @@
+#version 460
+
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_buffer_reference_uvec2 : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_shader_explicit_arithmetic_types : require
+
+layout(location = 0) in vec4 inColor;
+layout(location = 1) in vec2 inSquare;
+layout(location = 2) flat in uvec2 inMap;
+
+layout(location = 0) out vec4 outColor;
+
+// the header read by density.vert followed by one alpha per square, square (x, z) at x * depth + z
+layout(buffer_reference, scalar) restrict readonly buffer DensityMap {
+    ivec2 dims;
+    vec3 position;
+    float size;
+    u8vec4 color;
+    uint8_t alpha[];
+};
+
+void main() {
+    DensityMap map = DensityMap(inMap);
+    ivec2 square = clamp(ivec2(inSquare), ivec2(0), map.dims - 1);
+    uint alpha = uint(map.alpha[square.x * map.dims.y + square.y]);
+    if(alpha == 0) {
+        discard;
+    }
+
+    outColor = vec4(inColor.rgb, inColor.a * float(alpha) / 255.0f);
+}
\ No newline at end of file
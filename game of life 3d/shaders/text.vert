@@ -0,0 +1,144 @@
+#version 460
+
+#extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_scalar_block_layout : require
+#extension GL_EXT_shader_explicit_arithmetic_types : require
+
+// 8x8 bitmap font for ASCII 32 to 126, least significant bit is the leftmost pixel, x holds rows 0-3 and y rows 4-7
+const uvec2 font[95] = {
+    { 0x00000000u, 0x00000000u }, // ' '
+    { 0x183c3c18u, 0x00180018u }, // '!'
+    { 0x00003636u, 0x00000000u }, // '"'
+    { 0x367f3636u, 0x0036367fu }, // '#'
+    { 0x1e033e0cu, 0x000c1f30u }, // '$'
+    { 0x18336300u, 0x0063660cu }, // '%'
+    { 0x6e1c361cu, 0x006e333bu }, // '&'
+    { 0x00030606u, 0x00000000u }, // '''
+    { 0x06060c18u, 0x00180c06u }, // '('
+    { 0x18180c06u, 0x00060c18u }, // ')'
+    { 0xff3c6600u, 0x0000663cu }, // '*'
+    { 0x3f0c0c00u, 0x00000c0cu }, // '+'
+    { 0x00000000u, 0x060c0c00u }, // ','
+    { 0x3f000000u, 0x00000000u }, // '-'
+    { 0x00000000u, 0x000c0c00u }, // '.'
+    { 0x0c183060u, 0x00010306u }, // '/'
+    { 0x7b73633eu, 0x003e676fu }, // '0'
+    { 0x0c0c0e0cu, 0x003f0c0cu }, // '1'
+    { 0x1c30331eu, 0x003f3306u }, // '2'
+    { 0x1c30331eu, 0x001e3330u }, // '3'
+    { 0x33363c38u, 0x0078307fu }, // '4'
+    { 0x301f033fu, 0x001e3330u }, // '5'
+    { 0x1f03061cu, 0x001e3333u }, // '6'
+    { 0x1830333fu, 0x000c0c0cu }, // '7'
+    { 0x1e33331eu, 0x001e3333u }, // '8'
+    { 0x3e33331eu, 0x000e1830u }, // '9'
+    { 0x000c0c00u, 0x000c0c00u }, // ':'
+    { 0x000c0c00u, 0x060c0c00u }, // ';'
+    { 0x03060c18u, 0x00180c06u }, // '<'
+    { 0x003f0000u, 0x00003f00u }, // '='
+    { 0x30180c06u, 0x00060c18u }, // '>'
+    { 0x1830331eu, 0x000c000cu }, // '?'
+    { 0x7b7b633eu, 0x001e037bu }, // '@'
+    { 0x33331e0cu, 0x0033333fu }, // 'A'
+    { 0x3e66663fu, 0x003f6666u }, // 'B'
+    { 0x0303663cu, 0x003c6603u }, // 'C'
+    { 0x6666361fu, 0x001f3666u }, // 'D'
+    { 0x1e16467fu, 0x007f4616u }, // 'E'
+    { 0x1e16467fu, 0x000f0616u }, // 'F'
+    { 0x0303663cu, 0x007c6673u }, // 'G'
+    { 0x3f333333u, 0x00333333u }, // 'H'
+    { 0x0c0c0c1eu, 0x001e0c0cu }, // 'I'
+    { 0x30303078u, 0x001e3333u }, // 'J'
+    { 0x1e366667u, 0x00676636u }, // 'K'
+    { 0x0606060fu, 0x007f6646u }, // 'L'
+    { 0x7f7f7763u, 0x0063636bu }, // 'M'
+    { 0x7b6f6763u, 0x00636373u }, // 'N'
+    { 0x6363361cu, 0x001c3663u }, // 'O'
+    { 0x3e66663fu, 0x000f0606u }, // 'P'
+    { 0x3333331eu, 0x00381e3bu }, // 'Q'
+    { 0x3e66663fu, 0x00676636u }, // 'R'
+    { 0x0e07331eu, 0x001e3338u }, // 'S'
+    { 0x0c0c2d3fu, 0x001e0c0cu }, // 'T'
+    { 0x33333333u, 0x003f3333u }, // 'U'
+    { 0x33333333u, 0x000c1e33u }, // 'V'
+    { 0x6b636363u, 0x0063777fu }, // 'W'
+    { 0x1c366363u, 0x0063361cu }, // 'X'
+    { 0x1e333333u, 0x001e0c0cu }, // 'Y'
+    { 0x1831637fu, 0x007f664cu }, // 'Z'
+    { 0x0606061eu, 0x001e0606u }, // '['
+    { 0x180c0603u, 0x00406030u }, // '\'
+    { 0x1818181eu, 0x001e1818u }, // ']'
+    { 0x63361c08u, 0x00000000u }, // '^'
+    { 0x00000000u, 0xff000000u }, // '_'
+    { 0x00180c0cu, 0x00000000u }, // '`'
+    { 0x301e0000u, 0x006e333eu }, // 'a'
+    { 0x3e060607u, 0x003b6666u }, // 'b'
+    { 0x331e0000u, 0x001e3303u }, // 'c'
+    { 0x3e303038u, 0x006e3333u }, // 'd'
+    { 0x331e0000u, 0x001e033fu }, // 'e'
+    { 0x0f06361cu, 0x000f0606u }, // 'f'
+    { 0x336e0000u, 0x1f303e33u }, // 'g'
+    { 0x6e360607u, 0x00676666u }, // 'h'
+    { 0x0c0e000cu, 0x001e0c0cu }, // 'i'
+    { 0x30300030u, 0x1e333330u }, // 'j'
+    { 0x36660607u, 0x0067361eu }, // 'k'
+    { 0x0c0c0c0eu, 0x001e0c0cu }, // 'l'
+    { 0x7f330000u, 0x00636b7fu }, // 'm'
+    { 0x331f0000u, 0x00333333u }, // 'n'
+    { 0x331e0000u, 0x001e3333u }, // 'o'
+    { 0x663b0000u, 0x0f063e66u }, // 'p'
+    { 0x336e0000u, 0x78303e33u }, // 'q'
+    { 0x6e3b0000u, 0x000f0666u }, // 'r'
+    { 0x033e0000u, 0x001f301eu }, // 's'
+    { 0x0c3e0c08u, 0x00182c0cu }, // 't'
+    { 0x33330000u, 0x006e3333u }, // 'u'
+    { 0x33330000u, 0x000c1e33u }, // 'v'
+    { 0x6b630000u, 0x00367f7fu }, // 'w'
+    { 0x36630000u, 0x0063361cu }, // 'x'
+    { 0x33330000u, 0x1f303e33u }, // 'y'
+    { 0x193f0000u, 0x003f260cu }, // 'z'
+    { 0x070c0c38u, 0x00380c0cu }, // '{'
+    { 0x00181818u, 0x00181818u }, // '|'
+    { 0x380c0c07u, 0x00070c0cu }, // '}'
+    { 0x00003b6eu, 0x00000000u }  // '~'
+};
+
+vec2 corners[6] = {
+    { 0.0f, 0.0f },
+    { 1.0f, 0.0f },
+    { 0.0f, 1.0f },
+    { 0.0f, 1.0f },
+    { 1.0f, 0.0f },
+    { 1.0f, 1.0f }
+};
+
+layout(location = 0) out vec4 outColor;
+layout(location = 1) out vec2 outTexel;
+layout(location = 2) flat out uvec2 outBits;
+
+struct Glyph {
+    vec2 position;
+    float size;
+    uint code;
+    u8vec4 color;
+};
+
+layout(buffer_reference, scalar) restrict readonly buffer Glyphs {
+    Glyph glyphs[];
+};
+
+layout(push_constant, scalar) uniform constants {
+    Glyphs bda;
+    uint offset;
+    mat4 transform;
+} pcs;
+
+void main() {
+    Glyph cur = pcs.bda.glyphs[gl_InstanceIndex + pcs.offset];
+    vec2 corner = corners[gl_VertexIndex];
+
+    outColor = vec4(cur.color) / vec4(255.0f);
+    outTexel = corner * 8.0f;
+    outBits = font[clamp(cur.code, 32u, 126u) - 32u];
+    gl_Position = pcs.transform * vec4(cur.position + corner * cur.size, 0.0f, 1.0f);
+}
\ No newline at end of file
@@ -1,36 +1,10 @@
 #version 460
 
 #extension GL_EXT_buffer_reference2 : require
+#extension GL_EXT_buffer_reference_uvec2 : require
 #extension GL_EXT_scalar_block_layout : require
 #extension GL_EXT_shader_explicit_arithmetic_types : require
 
-vec3 vertices[24] = {
-    { -0.5f, -0.5f, -0.5f },
-    {  0.5f, -0.5f, -0.5f },
-    { -0.5f, -0.5f, -0.5f },
-    { -0.5f,  0.5f, -0.5f },
-    { -0.5f, -0.5f, -0.5f },
-    { -0.5f, -0.5f,  0.5f },
-    {  0.5f, -0.5f, -0.5f },
-    {  0.5f,  0.5f, -0.5f },
-    {  0.5f, -0.5f, -0.5f },
-    {  0.5f, -0.5f,  0.5f },
-    {  0.5f,  0.5f, -0.5f },
-    {  0.5f,  0.5f,  0.5f },
-    {  0.5f, -0.5f,  0.5f },
-    {  0.5f,  0.5f,  0.5f },
-    { -0.5f, -0.5f,  0.5f },
-    {  0.5f, -0.5f,  0.5f },
-    { -0.5f,  0.5f, -0.5f },
-    {  0.5f,  0.5f, -0.5f },
-    { -0.5f,  0.5f, -0.5f },
-    { -0.5f,  0.5f,  0.5f },
-    { -0.5f, -0.5f,  0.5f },
-    { -0.5f,  0.5f,  0.5f },
-    { -0.5f,  0.5f,  0.5f },
-    {  0.5f,  0.5f,  0.5f }
-};
-
 layout(location = 0) out vec4 outColor;
 
 struct Cube {
@@ -43,15 +17,63 @@ layout(buffer_reference, scalar) restrict readonly buffer Cubes {
     Cube cubes[];
 };
 
+// a grid cell as x | y << 10 | z << 20 and its palette index
+layout(buffer_reference, scalar) restrict readonly buffer Cells {
+    uvec2 cells[];
+};
+
+// what the packed cells are decoded against, cell (x, y, z) is centered at position + (x, y, z) * size
+layout(buffer_reference, scalar) restrict readonly buffer Grid {
+    vec3 position;
+    float size;
+    u8vec4 wire;
+    u8vec4 palette[256];
+};
+
+// the camera as of just before submission, written by the host into a per-frame buffer after recording
+layout(buffer_reference, scalar) restrict readonly buffer View {
+    mat4 transform;
+    vec4 planes[6];
+    vec3 eye;
+    float pixelScale;   // pixels covered by one unit at distance one, zero draws wires at any size
+};
+
 layout(push_constant, scalar) uniform constants {
     Cubes bda;
     uint offset;
     mat4 transform;
+    vec3 eye;
+    View view;
+    Grid grid;          // set when bda holds packed cells instead of cubes
 } pcs;
 
+Cube loadCube(uint index) {
+    if(uvec2(pcs.grid) == uvec2(0)) {
+        return pcs.bda.cubes[index];
+    }
+    uvec2 cell = Cells(pcs.bda).cells[index];
+    Cube cube;
+    cube.position = pcs.grid.position + vec3(cell.x & 0x3ff, (cell.x >> 10) & 0x3ff, cell.x >> 20) * pcs.grid.size;
+    cube.size = vec3(pcs.grid.size);
+    cube.color = pcs.grid.wire;
+    return cube;
+}
+
 void main() {
-    Cube cur = pcs.bda.cubes[gl_VertexIndex / 24];
-    
+    Cube cur = loadCube(gl_InstanceIndex);
+
+    // a cube under a pixel across would only add a speck of lines, every corner goes to the same point behind the near plane
+    vec4 center = pcs.view.transform * vec4(cur.position, 1.0f);
+    float extent = max(cur.size.x, max(cur.size.y, cur.size.z));
+    if(pcs.view.pixelScale > 0.0f && center.w > 0.0f && extent * pcs.view.pixelScale < center.w) {
+        outColor = vec4(0.0f);
+        gl_Position = vec4(0.0f, 0.0f, -1.0f, 1.0f);
+        return;
+    }
+
+    // the index buffer picks one of the 8 corners, bit 0 is +x, bit 1 is +y and bit 2 is +z
+    vec3 corner = vec3(gl_VertexIndex & 1, (gl_VertexIndex >> 1) & 1, (gl_VertexIndex >> 2) & 1) - 0.5f;
+
     outColor = vec4(cur.color) / vec4(255.0f);
-    gl_Position = pcs.transform * vec4(vertices[gl_VertexIndex % 24] * cur.size + cur.position, 1.0f);
+    gl_Position = pcs.view.transform * vec4(corner * cur.size + cur.position, 1.0f);
 }
\ No newline at end of file